@@ -7,6 +7,7 @@
 #include <string>
 #include "utils/communication.h"
 #include "utils/hdfs_core.h"
+#include "utils/record_io.h"
 #include "utils/combiner.h"
 #include "utils/aggregator.h"
 using namespace std;
@@ -41,6 +42,7 @@ public:
 		aggregator = NULL;
 		global_aggregator = NULL;
 		global_agg = NULL;
+		load_path = NULL;
 	}
 
 	void setCombiner(Combiner<MessageT>* cb)
@@ -295,23 +297,63 @@ public:
 		add_vertex(v);
 	}
 
+	//binary stage format: "type" is the record type in the file header
+	virtual VertexT* toVertex(obinstream& m, int type)
+	{
+		fprintf(stderr, "This worker does not read the binary stage format!\n");
+		exit(-1);
+	}
+
+	//for toVertex(m, type): exits if the file being loaded does not hold "expected" records, e.g., the output
+	//of another stage, "what" names what it should be
+	void check_type(int type, int expected, const char* what)
+	{
+		if (type != expected)
+		{
+			fprintf(stderr, "%s is not %s!\n", load_path, what);
+			exit(-1);
+		}
+	}
+
 	void load_graph(const char* inpath)
 	{
 		hdfsFS fs = getHdfsFS();
 		hdfsFile in = getRHandle(inpath, fs);
-		LineReader reader(fs, in);
-		while (true)
+		if (binary_stage_io)
 		{
-			reader.readLine();
-			if (!reader.eof())
-				load_vertex(toVertex(reader.getLine()));
-			else
-				break;
+			RecordReader reader(fs, in, inpath);
+			load_records(reader);
+		}
+		else
+		{
+			LineReader reader(fs, in);
+			while (true)
+			{
+				reader.readLine();
+				if (!reader.eof())
+					load_vertex(toVertex(reader.getLine()));
+				else
+					break;
+			}
 		}
 		hdfsCloseFile(fs, in);
 		hdfsDisconnect(fs);
 		//cout<<"Worker "<<_my_rank<<": \""<<inpath<<"\" loaded"<<endl;//DEBUG !!!!!!!!!!
 	}
+
+	//the records of a stage file, or those this rank wrote for an in-memory stage
+	void load_records(RecordReader& reader)
+	{
+		load_path = reader.path;
+		while (reader.next())
+			load_vertex(toVertex(reader.in(), reader.type()));
+	}
+
+	//loads the splits of "inpaths" dispatched by the master, and this rank's part of the in-memory stages
+	void load_inputs(const vector<string>& inpaths, bool native_dispatcher)
+	{
+		load_stage_inputs(this, &Worker::load_graph, &Worker::load_records, inpaths, native_dispatcher);
+	}
 	//=======================================================
 
 	//user-defined graphDumper ==============================
@@ -323,9 +365,26 @@ public:
 		return false;
 	}
 
+	//binary stage format: the writers call check() themselves
+	virtual void torecord(VertexT* v, RecordWriter& writer) {};
+	virtual void torecord(VertexT* v, vector<RecordWriter *> & writers) {};
+	virtual int record_type(int output) //record type written to the header of the output-th output
+	{
+		return 0;
+	}
+
 	void dump_partition(const char* outpath)
 	{
 		hdfsFS fs = getHdfsFS();
+		if (binary_stage_io)
+		{
+			RecordWriter* writer = new RecordWriter(outpath, fs, _my_rank, record_type(0));
+			for (VertexIter it = vertexes.begin(); it != vertexes.end(); it++)
+				torecord(*it, *writer);
+			delete writer;
+			hdfsDisconnect(fs);
+			return;
+		}
 		BufferedWriter* writer = new BufferedWriter(outpath, fs, _my_rank);
 
 		for (VertexIter it = vertexes.begin(); it != vertexes.end(); it++)
@@ -340,6 +399,18 @@ public:
 	void dump_partition(vector<string> output_paths)
 	{
 		hdfsFS fs = getHdfsFS();
+		if (binary_stage_io)
+		{
+			vector<RecordWriter *> writers;
+			for(int i = 0; i < output_paths.size(); i++)
+				writers.push_back(new RecordWriter(output_paths[i].c_str(), fs, _my_rank, record_type(i)));
+			for (VertexIter it = vertexes.begin(); it != vertexes.end(); it++)
+				torecord(*it, writers);
+			for(int  i = 0 ; i < writers.size(); i++)
+				delete writers[i];
+			hdfsDisconnect(fs);
+			return;
+		}
 		vector<BufferedWriter *> writers;
 		for(int i = 0; i < output_paths.size(); i++)
 		{
@@ -372,28 +443,7 @@ public:
 
 		//dispatch splits
 		ResetTimer(WORKER_TIMER);
-		vector<vector<string> >* arrangement;
-		if (_my_rank == MASTER_RANK)
-		{
-			arrangement = params.native_dispatcher ? dispatchLocality(params.input_path.c_str()) : dispatchRan(params.input_path.c_str());
-			//reportAssignment(arrangement);//DEBUG !!!!!!!!!!
-			masterScatter(*arrangement);
-			vector<string>& assignedSplits = (*arrangement)[0];
-			//reading assigned splits (map)
-			for (vector<string>::iterator it = assignedSplits.begin();
-			        it != assignedSplits.end(); it++)
-				load_graph(it->c_str());
-			delete arrangement;
-		}
-		else
-		{
-			vector<string> assignedSplits;
-			slaveScatter(assignedSplits);
-			//reading assigned splits (map)
-			for (vector<string>::iterator it = assignedSplits.begin();
-			        it != assignedSplits.end(); it++)
-				load_graph(it->c_str());
-		}
+		load_inputs(vector<string>(1, params.input_path), params.native_dispatcher);
 
 		//send vertices according to hash_id (reduce)
 		sync_graph();
@@ -494,28 +544,7 @@ public:
 
 		//dispatch splits
 		ResetTimer(WORKER_TIMER);
-		vector<vector<string> >* arrangement;
-		if (_my_rank == MASTER_RANK)
-		{
-			arrangement = params.native_dispatcher ? dispatchLocality(params.input_path.c_str()) : dispatchRan(params.input_path.c_str());
-			//reportAssignment(arrangement);//DEBUG !!!!!!!!!!
-			masterScatter(*arrangement);
-			vector<string>& assignedSplits = (*arrangement)[0];
-			//reading assigned splits (map)
-			for (vector<string>::iterator it = assignedSplits.begin();
-			        it != assignedSplits.end(); it++)
-				load_graph(it->c_str());
-			delete arrangement;
-		}
-		else
-		{
-			vector<string> assignedSplits;
-			slaveScatter(assignedSplits);
-			//reading assigned splits (map)
-			for (vector<string>::iterator it = assignedSplits.begin();
-			        it != assignedSplits.end(); it++)
-				load_graph(it->c_str());
-		}
+		load_inputs(vector<string>(1, params.input_path), params.native_dispatcher);
 
 		//send vertices according to hash_id (reduce)
 		sync_graph();
@@ -662,28 +691,7 @@ public:
 
 		//dispatch splits
 		ResetTimer(WORKER_TIMER);
-		vector<vector<string> >* arrangement;
-		if (_my_rank == MASTER_RANK)
-		{
-			arrangement = params.native_dispatcher ? dispatchLocality(params.input_path.c_str()) : dispatchRan(params.input_path.c_str());
-			//reportAssignment(arrangement);//DEBUG !!!!!!!!!!
-			masterScatter(*arrangement);
-			vector<string>& assignedSplits = (*arrangement)[0];
-			//reading assigned splits (map)
-			for (vector<string>::iterator it = assignedSplits.begin();
-			        it != assignedSplits.end(); it++)
-				load_graph(it->c_str());
-			delete arrangement;
-		}
-		else
-		{
-			vector<string> assignedSplits;
-			slaveScatter(assignedSplits);
-			//reading assigned splits (map)
-			for (vector<string>::iterator it = assignedSplits.begin();
-			        it != assignedSplits.end(); it++)
-				load_graph(it->c_str());
-		}
+		load_inputs(vector<string>(1, params.input_path), params.native_dispatcher);
 
 		//send vertices according to hash_id (reduce)
 		sync_graph();
@@ -784,28 +792,7 @@ public:
 
 		//dispatch splits
 		ResetTimer(WORKER_TIMER);
-		vector<vector<string> >* arrangement;
-		if (_my_rank == MASTER_RANK)
-		{
-			arrangement = params.native_dispatcher ? dispatchLocality(params.input_path.c_str()) : dispatchRan(params.input_path.c_str());
-			//reportAssignment(arrangement);//DEBUG !!!!!!!!!!
-			masterScatter(*arrangement);
-			vector<string>& assignedSplits = (*arrangement)[0];
-			//reading assigned splits (map)
-			for (vector<string>::iterator it = assignedSplits.begin();
-			        it != assignedSplits.end(); it++)
-				load_graph(it->c_str());
-			delete arrangement;
-		}
-		else
-		{
-			vector<string> assignedSplits;
-			slaveScatter(assignedSplits);
-			//reading assigned splits (map)
-			for (vector<string>::iterator it = assignedSplits.begin();
-			        it != assignedSplits.end(); it++)
-				load_graph(it->c_str());
-		}
+		load_inputs(vector<string>(1, params.input_path), params.native_dispatcher);
 
 		//send vertices according to hash_id (reduce)
 		sync_graph();
@@ -953,28 +940,7 @@ public:
 
 		//dispatch splits
 		ResetTimer(WORKER_TIMER);
-		vector<vector<string> >* arrangement;
-		if (_my_rank == MASTER_RANK)
-		{
-			arrangement = params.native_dispatcher ? dispatchLocality(params.input_paths) : dispatchRan(params.input_paths);
-//            reportAssignment(arrangement);//DEBUG !!!!!!!!!!
-			masterScatter(*arrangement);
-			vector<string>& assignedSplits = (*arrangement)[0];
-			//reading assigned splits (map)
-			for (vector<string>::iterator it = assignedSplits.begin();
-			        it != assignedSplits.end(); it++)
-				load_graph(it->c_str());
-			delete arrangement;
-		}
-		else
-		{
-			vector<string> assignedSplits;
-			slaveScatter(assignedSplits);
-			//reading assigned splits (map)
-			for (vector<string>::iterator it = assignedSplits.begin();
-			        it != assignedSplits.end(); it++)
-				load_graph(it->c_str());
-		}
+		load_inputs(params.input_paths, params.native_dispatcher);
 
 		//send vertices according to hash_id (reduce)
 		sync_graph();
@@ -1075,28 +1041,7 @@ public:
 
 		//dispatch splits
 		ResetTimer(WORKER_TIMER);
-		vector<vector<string> >* arrangement;
-		if (_my_rank == MASTER_RANK)
-		{
-			arrangement = params.native_dispatcher ? dispatchLocality(params.input_path.c_str()) : dispatchRan(params.input_path.c_str());
-			//reportAssignment(arrangement);//DEBUG !!!!!!!!!!
-			masterScatter(*arrangement);
-			vector<string>& assignedSplits = (*arrangement)[0];
-			//reading assigned splits (map)
-			for (vector<string>::iterator it = assignedSplits.begin();
-			        it != assignedSplits.end(); it++)
-				load_graph(it->c_str());
-			delete arrangement;
-		}
-		else
-		{
-			vector<string> assignedSplits;
-			slaveScatter(assignedSplits);
-			//reading assigned splits (map)
-			for (vector<string>::iterator it = assignedSplits.begin();
-			        it != assignedSplits.end(); it++)
-				load_graph(it->c_str());
-		}
+		load_inputs(vector<string>(1, params.input_path), params.native_dispatcher);
 
 		//send vertices according to hash_id (reduce)
 		sync_graph();
@@ -1224,6 +1169,7 @@ private:
 	HashT hash;
 	VertexContainer vertexes;
 	int active_count;
+	const char* load_path; //the file being loaded, for check_type()
 
 	MessageBuffer<VertexT>* message_buffer;
 	Combiner<MessageT>* combiner;
@@ -4,6 +4,7 @@
 #include "utils/type.h"
 #include "basic/DNAPregel-dev.h"
 #include "GlobalDna.h"
+#include "Minimizer.h"
 using namespace std;
 
 struct ConnContigValue
@@ -117,14 +118,12 @@ obinstream & operator>>(obinstream & m, ConnValue & v)
 	return m;
 }
 
-static int tipLength_threshold;
-
-class ConnVertex: public Vertex<k_mer, ConnValue, ContigNB>
+class ConnVertex: public Vertex<k_mer, ConnValue, ContigNB, MinimizerHash<k_mer> >
 {
 public:
 	u8 getType(ConnContigValue * value)
 	{
-		if(value->seq.length > tipLength_threshold) return CONTIG_TYPE;
+		if(value->seq.length > stage_dna().tip_threshold) return CONTIG_TYPE;
 		if(value->in_neighbor == NULL_MER) return TIP_TYPE;
 		if(value->out_neighbor == NULL_MER) return TIP_TYPE;
 		return CONTIG_TYPE;
@@ -180,12 +179,14 @@ public:
 class ConnectWorker:public Worker<ConnVertex>
 {
 	char buf[1024];
+	DnaContext dna;
 
 public:
-	ConnectWorker(int k, int tip_len)
+	ConnectWorker(int k, int tip_len, int minimizer_len)
 	{
-		set_mer_length(k);
-		tipLength_threshold = k - 1 + tip_len;
+		dna.init(k, minimizer_len);
+		dna.tip_threshold = k - 1 + tip_len;
+		set_stage_dna(dna);
 	}
 
 	virtual ConnVertex* toVertex(char* line)
@@ -234,16 +235,87 @@ public:
 			val->seq.length = atoi(pch);
 			pch=strtok(NULL, " ");
 			int size  =  atoi(pch);
+			vector<u8> bytes(size);
 			for(int i = 0; i < size; i++)
 			{
 				pch=strtok(NULL, " ");
-				val->seq.seq.push_back((u8)atoi(pch));
+				bytes[i] = (u8)atoi(pch);
+			}
+			val->seq.set_bytes(bytes.empty() ? NULL : &bytes[0], size);
+			v->value().value = val;
+		}
+		return v;
+	}
+
+	virtual ConnVertex* toVertex(obinstream& m, int type) //REC_AMBI_VERTEX or REC_CONTIG
+	{
+		ConnVertex* v=new ConnVertex;
+		if(type == REC_AMBI_VERTEX)
+		{
+			m >> v->id;
+			v->value().type = AMBI_TYPE;
+			ConnAmbiValue * val = new ConnAmbiValue;
+			u32 size;
+			m >> size;
+			val->ambi_nbs.resize(size);
+			val->freqs.resize(size);
+			for(int i = 0; i< size; i++)
+			{
+				m >> val->ambi_nbs[i].bitmap;
+				m >> val->freqs[i];
 			}
 			v->value().value = val;
 		}
+		else
+		{
+			check_type(type, REC_CONTIG, "an ambiguous vertex or contig output");
+			Contig contig;
+			contig.parse(m);
+			v->id = contig.id;
+			v->value().type = CONTIG_TYPE;
+			ConnContigValue * val = new ConnContigValue;
+			val->in_neighbor = contig.in_neighbor;
+			val->in_pol = contig.in_pol;
+			val->in_count = contig.in_count;
+			val->out_neighbor = contig.out_neighbor;
+			val->out_pol = contig.out_pol;
+			val->out_count = contig.out_count;
+			val->freq = contig.freq;
+			val->seq.swap(contig.seq);
+			v->value().value = val;
+		}
 		return v;
 	}
 
+	virtual int record_type(int output)
+	{
+		return REC_AMBI_CONNECT;
+	}
+
+	virtual void torecord(ConnVertex* v, RecordWriter& writer)
+	{
+		//ambi_nbs are written in the layout of vector<AmbiNB>, which TipRemoval reads directly
+		ConnValue & value = v->value();
+		if(value.type == AMBI_TYPE)
+		{
+			ConnAmbiValue * val = (ConnAmbiValue *)(value.value);
+			size_t size_amb = val->ambi_nbs.size();
+			if(size_amb > 0 || val->contig_nbs.size() > 0)
+			{
+				writer.check();
+				writer.m << v->id;
+				writer.m << size_amb;
+				for(int i=0; i<size_amb; i++)
+				{
+					writer.m << val->ambi_nbs[i];
+					writer.m << (int)val->freqs[i];
+				}
+				writer.m << val->contig_nbs;
+				writer.end_record();
+			}
+		}
+	}
+
 	virtual void toline(ConnVertex* v, BufferedWriter& writer)
 	{
 		ConnValue & value = v->value();
@@ -254,7 +326,7 @@ public:
 			int size_con = val->contig_nbs.size();
 			if(size_amb > 0 || size_con > 0)
 			{
-				sprintf(buf, "%llu\t%d", v->id, size_amb);
+				sprintf(buf, KMER_FMT "\t%d", v->id, size_amb);
 				writer.write(buf);
 				for(int i=0; i<size_amb; i++)
 				{
@@ -266,7 +338,7 @@ public:
 				for(int i=0; i<size_con; i++)
 				{
 					ContigNB & cur = val->contig_nbs[i];
-					sprintf(buf, " %llu %u %llu %d", cur.nid, cur.ninfo.bitmap, cur.contigID, cur.length);
+					sprintf(buf, " " KMER_FMT " %u " KMER_FMT " %d", cur.nid, cur.ninfo.bitmap, cur.contigID, cur.length);
 					writer.write(buf);
 				}
 				writer.write("\n");
@@ -275,7 +347,7 @@ public:
 	}
 };
 
-void AmbiConnect(string amb_path, string contig_path, string out_path, int mer_len, int tip_len)
+void AmbiConnect(string amb_path, string contig_path, string out_path, int mer_len, int tip_len, int minimizer_len = 0)
 {
 	MultiInputParams param;
 	param.input_paths.push_back(amb_path);
@@ -284,7 +356,7 @@ void AmbiConnect(string amb_path, string contig_path, string out_path, int mer_l
 	param.force_write=true;
 	param.native_dispatcher=false;
 //	init_workers();
-	ConnectWorker worker(mer_len, tip_len);
+	ConnectWorker worker(mer_len, tip_len, minimizer_len);
 	worker.run(param);
 //	worker_finalize();
 }
@@ -4,10 +4,12 @@
 #include "utils/type.h"
 #include "basic/DNAPregel-dev.h"
 #include "GlobalDna.h"
+#include "Minimizer.h"
 
 using namespace std;
 
-bool Amb_is_SV = false;
+//true once list ranking converges, kept by the AmbLRAgg of the worker (defined below)
+inline bool Amb_is_SV();
 
 struct AmbLRValue
 {
@@ -35,20 +37,20 @@ obinstream & operator>>(obinstream & m,  AmbLRValue & v)
 	return m;
 }
 
-class AmbLRVertex: public Vertex<k_mer, AmbLRValue, k_mer>
+class AmbLRVertex: public Vertex<k_mer, AmbLRValue, k_mer, MinimizerHash<k_mer> >
 {
 public:
 
 	inline k_mer is_contig_end(k_mer s) //return type treated as bool
 	{
-		return s >> (mer_length*2);
+		return s >> (stage_dna().mer_length*2);
 	}
 
 	void get_neighbors(vector<k_mer> & collector)
 	{
 		for(int i = 0; i < value().ambi_nbs.size(); i++)
 		{
-			collector.push_back(get_neighbor(id, value().ambi_nbs[i].nb_info));
+			collector.push_back(get_neighbor(id, value().ambi_nbs[i].nb_info, stage_dna()));
 		}
 		for(int i = 0; i< value().contig_nbs.size(); i++)
 		{
@@ -62,7 +64,7 @@ public:
 		//ambiguous vertices vote to halt; //unambiguous vertices set "preds" properly
 		if(value().type == V_1)
 		{
-			k_mer self = (id | END_MER);
+			k_mer self = (id | stage_dna().end_mer);
 			value().preds.push_back(self); //one pred is itself
 			//another is the only neighbor
 			if(msgs.size() == 1)
@@ -83,13 +85,13 @@ public:
 		{
 			if(msgs.size() == 2) //itself is a contig
 			{
-				k_mer self = (id | END_MER);
+				k_mer self = (id | stage_dna().end_mer);
 				value().preds.push_back(self);
 				value().preds.push_back(self);
 			}
 			else if(msgs.size() == 1)
 			{
-				k_mer self = (id | END_MER);
+				k_mer self = (id | stage_dna().end_mer);
 				value().preds.push_back(self);
 				//find the other neighbor
 				vector<k_mer> nbs;
@@ -105,7 +107,7 @@ public:
 			}
 			else //msgs.size() == 0
 			{
-				k_mer self = (id | END_MER);
+				k_mer self = (id | stage_dna().end_mer);
 				vector<k_mer> nbs;
 				get_neighbors(nbs);
 				if(nbs.size() == 0)
@@ -138,7 +140,7 @@ public:
 	{
 		for(int i=0; i<msgs.size(); i++)
 		{
-			if(msgs[i] == (value().preds[0] & kick)) send_message(msgs[i], value().preds[1]);
+			if(msgs[i] == (value().preds[0] & stage_dna().kick)) send_message(msgs[i], value().preds[1]);
 			else send_message(msgs[i], value().preds[0]);
 		}
 	}
@@ -232,7 +234,7 @@ public:
 
 	virtual void compute(MessageContainer & messages)
 	{
-		if(! Amb_is_SV)
+		if(! Amb_is_SV())
 		{
 			if(step_num() == 1)
 			{
@@ -325,10 +327,13 @@ private:
 	long long int msgs_size;
 
 public:
+	bool is_SV; //switched on once list ranking converges
+
 	AmbLRAgg(long long int msgs)
 	{
 		msgs_size = msgs;
 		AND = true;
+		is_SV = false;
 	}
 
 	virtual void init()
@@ -338,7 +343,7 @@ public:
 
 	virtual void stepPartial(AmbLRVertex* v)
 	{
-		if(Amb_is_SV)
+		if(is_SV)
 		{
 			if (step_num() % 7 == 0)
 				if (v->value().preds[0]  != v->value().preds[1])
@@ -356,7 +361,7 @@ public:
 
 	virtual bool* finishPartial()
 	{
-		if(!Amb_is_SV)
+		if(!is_SV)
 		{
 			if(step_num() % 2 == 1)
 			{
@@ -364,7 +369,7 @@ public:
 					msgs_size = get_step_msg_num();
 				else
 				{
-					Amb_is_SV = true;
+					is_SV = true;
 					global_step_num = 0;
 				}
 			}
@@ -374,7 +379,7 @@ public:
 
 	virtual bool* finishFinal()
 	{
-		if(!Amb_is_SV)
+		if(!is_SV)
 		{
 			if(step_num() % 2 == 1)
 			{
@@ -382,7 +387,7 @@ public:
 					msgs_size = get_step_msg_num();
 				else
 				{
-					Amb_is_SV = true;
+					is_SV = true;
 					global_step_num = 0;
 				}
 			}
@@ -391,16 +396,22 @@ public:
 	}
 };
 
+inline bool Amb_is_SV()
+{
+	return ((AmbLRAgg*)get_aggregator())->is_SV;
+}
+
 class AmbLRWorker:public Worker<AmbLRVertex, AmbLRAgg>
 {
 	char buf[100];
+	DnaContext dna;
 
 public:
 
-	AmbLRWorker(int k)
+	AmbLRWorker(int k, int minimizer_len)
 	{
-		set_mer_length(k);
-		END_MER = 1ull << (2*mer_length);
+		dna.init(k, minimizer_len);
+		set_stage_dna(dna);
 	}
 
 	virtual AmbLRVertex* toVertex(char* line)
@@ -440,14 +451,57 @@ public:
 		return v;
 	}
 
+	virtual AmbLRVertex* toVertex(obinstream& m, int type) //REC_NOTIP
+	{
+		check_type(type, REC_NOTIP, "a TipRemoval output");
+		AmbLRVertex* v=new AmbLRVertex;
+		m >> v->id;
+		m >> v->value().type;
+		m >> v->value().ambi_nbs;
+		m >> v->value().contig_nbs;
+		return v;
+	}
+
+	virtual int record_type(int output)
+	{
+		return REC_AMBI_LINK;
+	}
+
+	virtual void torecord(AmbLRVertex* v, RecordWriter& writer)
+	{
+		AmbLRValue & value = v->value();
+		k_mer pred;
+		if(value.type != Vm_n)
+		{
+			k_mer pred1 = (value.preds[0] & stage_dna().kick);
+			k_mer pred2 = (value.preds[1] & stage_dna().kick);
+			if(pred1 > pred2)
+			{
+				pred1 = pred2;
+			}
+			pred = pred1;
+		}
+		else
+		{
+			pred = NULL_MER;
+		}
+		writer.check();
+		writer.m << v->id;
+		writer.m << pred;
+		writer.m << value.type;
+		writer.m << value.ambi_nbs;
+		writer.m << value.contig_nbs;
+		writer.end_record();
+	}
+
 	virtual void toline(AmbLRVertex* v, BufferedWriter& writer)
 	{
 		AmbLRValue & value = v->value();
 		k_mer pred;
 		if(value.type != Vm_n)
 		{
-			k_mer pred1 = (value.preds[0] & kick);
-			k_mer pred2 = (value.preds[1] & kick);
+			k_mer pred1 = (value.preds[0] & stage_dna().kick);
+			k_mer pred2 = (value.preds[1] & stage_dna().kick);
 			if(pred1 > pred2)
 			{
 				pred1 = pred2;
@@ -459,7 +513,7 @@ public:
 			pred = NULL_MER;
 		}
 		int size = value.ambi_nbs.size();
-		sprintf(buf, "%llu\t%llu %u %d", v->id, pred, value.type, size);
+		sprintf(buf, KMER_FMT "\t" KMER_FMT " %u %d", v->id, pred, value.type, size);
 		writer.write(buf);
 		//------
 		for(int i = 0; i < size; i++)
@@ -475,14 +529,14 @@ public:
 		for(int i = 0; i < size; i++)
 		{
 			ContigNB & nb = value.contig_nbs[i];
-			sprintf(buf, " %llu %u %llu %d", nb.nid, nb.ninfo.bitmap, nb.contigID, nb.length);
+			sprintf(buf, " " KMER_FMT " %u " KMER_FMT " %d", nb.nid, nb.ninfo.bitmap, nb.contigID, nb.length);
 			writer.write(buf);
 		}
 		writer.write(" #\n");
 	}
 };
 
-void AmbListRank(string in_path, string out_path, int length)
+void AmbListRank(string in_path, string out_path, int length, int minimizer_len = 0)
 {
 	WorkerParams param;
 	param.input_path=in_path;
@@ -490,7 +544,7 @@ void AmbListRank(string in_path, string out_path, int length)
 	param.force_write=true;
 	param.native_dispatcher=false;
 //	init_workers();
-	AmbLRWorker worker(length);
+	AmbLRWorker worker(length, minimizer_len);
 	AmbLRAgg agg = AmbLRAgg(-1);
 	worker.setAggregator(&agg);
 	worker.run(param);
@@ -5,6 +5,7 @@
 #include "basic/DNAPregel-dev.h" //e.g. for DefaultHash, and other serialization functions
 #include "GlobalDna.h"
 #include "DNAMessageBuffer.h"
+#include "utils/fasta_writer.h"
 
 
 class AmbiVertex
@@ -54,6 +55,18 @@ public:
 		return group;
 	}
 
+	k_mer parse(obinstream& m) //REC_AMBI_LINK, same fields as the text line
+	{
+		//return group_id
+		k_mer group;
+		m >> id;
+		m >> group;
+		m >> type;
+		m >> ambi_nbs;
+		m >> contig_nbs;
+		return group;
+	}
+
 	friend ibinstream& operator<<(ibinstream& m, const AmbiVertex& v)
 	{
 		m << v.id;
@@ -78,14 +91,11 @@ class AmbiContig
 public:
 	ATGC_bitmap seq;
 
-	void dumpTo(BufferedWriter* writer, int line_num)
+	void dumpTo(FastaWriter* writer, int line_num)
 	{
-		char buf[50000];
-		writer->check();
-		sprintf(buf, "%s-%d-%d\n", ">contig", _my_rank,line_num+1);
-		writer->write(buf);
-		sprintf(buf, "%s\n", seq.toString().c_str());
-		writer->write(buf);
+		char name[50];
+		sprintf(name, "contig-%d-%d", _my_rank, line_num+1);
+		writer->add(name, seq.words.empty() ? NULL : &seq.words[0], seq.length);
 	}
 
 	friend ibinstream& operator<<(ibinstream& m, const AmbiContig& v)
@@ -192,7 +202,7 @@ public:
 		return m;
 	}
 
-	k_mer find_head_ambicontig()
+	k_mer find_head_ambicontig(const DnaContext & dna)
 	{
 		hash_map<k_mer, int> member_pos;
 		int count = members.size();
@@ -203,7 +213,7 @@ public:
 		k_mer next;
 		if(cur->ambi_nbs.size() == 2)
 		{
-			next = get_neighbor(cur->id, cur->ambi_nbs[0].nb_info);
+			next = get_neighbor(cur->id, cur->ambi_nbs[0].nb_info, dna);
 		}
 		else
 		{
@@ -221,10 +231,10 @@ public:
 			}
 			if(cur->ambi_nbs.size() == 2)
 			{
-				next = get_neighbor(cur->id, cur->ambi_nbs[0].nb_info);
+				next = get_neighbor(cur->id, cur->ambi_nbs[0].nb_info, dna);
 				if(next == pre->id)
 				{
-					next =  get_neighbor(cur->id, cur->ambi_nbs[1].nb_info);
+					next =  get_neighbor(cur->id, cur->ambi_nbs[1].nb_info, dna);
 				}
 			}
 			else if (cur->contig_nbs.size() == 2)
@@ -237,7 +247,7 @@ public:
 			}
 			else
 			{
-				next  = get_neighbor(cur->id, cur->ambi_nbs[0].nb_info);
+				next  = get_neighbor(cur->id, cur->ambi_nbs[0].nb_info, dna);
 				if(next == pre->id)
 				{
 					next  = cur->contig_nbs[0].nid;
@@ -252,7 +262,7 @@ public:
 		return NULL_MER;
 	}
 
-	k_mer find_tail_ambicontig()
+	k_mer find_tail_ambicontig(const DnaContext & dna)
 	{
 		hash_map<k_mer, int> member_pos;
 		int count = members.size();
@@ -264,7 +274,7 @@ public:
 			if(cur->ambi_nbs.size())
 			{
 				neighbor_info & ninfo = cur->ambi_nbs[0].nb_info;
-				next = get_neighbor(cur->id, ninfo);
+				next = get_neighbor(cur->id, ninfo, dna);
 			}
 			else
 			{
@@ -275,7 +285,7 @@ public:
 		{
 			if(cur->ambi_nbs.size() == 2)
 			{
-				next = get_neighbor(cur->id, cur->ambi_nbs[1].nb_info);
+				next = get_neighbor(cur->id, cur->ambi_nbs[1].nb_info, dna);
 			}
 			else if (cur->contig_nbs.size() == 2)
 			{
@@ -283,7 +293,7 @@ public:
 			}
 			else
 			{
-				next = get_neighbor(cur->id, cur->ambi_nbs[0].nb_info);
+				next = get_neighbor(cur->id, cur->ambi_nbs[0].nb_info, dna);
 			}
 		}
 		if(member_pos.find(next) == member_pos.end())
@@ -298,10 +308,10 @@ public:
 			}
 			if(cur->ambi_nbs.size() == 2)
 			{
-				next = get_neighbor(cur->id, cur->ambi_nbs[0].nb_info);
+				next = get_neighbor(cur->id, cur->ambi_nbs[0].nb_info, dna);
 				if(next == pre->id)
 				{
-					next =  get_neighbor(cur->id, cur->ambi_nbs[1].nb_info);
+					next =  get_neighbor(cur->id, cur->ambi_nbs[1].nb_info, dna);
 				}
 			}
 			else if (cur->contig_nbs.size() == 2)
@@ -314,7 +324,7 @@ public:
 			}
 			else
 			{
-				next  = get_neighbor(cur->id, cur->ambi_nbs[0].nb_info);
+				next  = get_neighbor(cur->id, cur->ambi_nbs[0].nb_info, dna);
 				if(next == pre->id)
 				{
 					next  = cur->contig_nbs[0].nid;
@@ -329,7 +339,7 @@ public:
 		return NULL_MER;
 	}
 
-	void  reorder_ambiVSet(k_mer head = NULL_MER)
+	void  reorder_ambiVSet(const DnaContext & dna, k_mer head = NULL_MER)
 	{
 		hash_map<k_mer, int> member_pos;
 		int count = members.size();
@@ -347,7 +357,7 @@ public:
 			if(cur->ambi_nbs.size())
 			{
 				neighbor_info & ninfo = cur->ambi_nbs[0].nb_info;
-				k_mer nb = get_neighbor(cur->id, ninfo);
+				k_mer nb = get_neighbor(cur->id, ninfo, dna);
 				if(ninfo.is_in())
 					ninfo.reverse();
 				order.push_back(vtuple(cur->id, ninfo.left_isH(), false));
@@ -382,8 +392,8 @@ public:
 		{
 			if(cur->ambi_nbs.size() == 2)
 			{
-				k_mer nb1 = get_neighbor(cur->id, cur->ambi_nbs[0].nb_info);
-				k_mer nb2 = get_neighbor(cur->id, cur->ambi_nbs[1].nb_info);
+				k_mer nb1 = get_neighbor(cur->id, cur->ambi_nbs[0].nb_info, dna);
+				k_mer nb2 = get_neighbor(cur->id, cur->ambi_nbs[1].nb_info, dna);
 				int index;
 				if(member_pos.find(nb1) != member_pos.end())
 				{
@@ -451,7 +461,7 @@ public:
 			}
 			else
 			{
-				k_mer nb1 = get_neighbor(cur->id, cur->ambi_nbs[0].nb_info);
+				k_mer nb1 = get_neighbor(cur->id, cur->ambi_nbs[0].nb_info, dna);
 				k_mer nb2  = cur->contig_nbs[0].nid;
 				if(member_pos.find(nb1) != member_pos.end())
 				{
@@ -508,8 +518,8 @@ public:
 			{
 				if(cur->ambi_nbs.size() == 2)
 				{
-					k_mer nb1 = get_neighbor(cur->id, cur->ambi_nbs[0].nb_info);
-					k_mer nb2 = get_neighbor(cur->id, cur->ambi_nbs[1].nb_info);
+					k_mer nb1 = get_neighbor(cur->id, cur->ambi_nbs[0].nb_info, dna);
+					k_mer nb2 = get_neighbor(cur->id, cur->ambi_nbs[1].nb_info, dna);
 					int index;
 					if(nb1 != pre->id)
 					{
@@ -553,7 +563,7 @@ public:
 				}
 				else
 				{
-					k_mer nb1 = get_neighbor(cur->id, cur->ambi_nbs[0].nb_info);
+					k_mer nb1 = get_neighbor(cur->id, cur->ambi_nbs[0].nb_info, dna);
 					k_mer nb2  = cur->contig_nbs[0].nid;
 					if(nb1 != pre->id)
 					{
@@ -594,54 +604,33 @@ public:
 		return -1;
 	}
 
-	void merge_sequence(AmbiContig * ambicontig, vector<MessageValue> & msgs, int index)
+	void merge_sequence(AmbiContig * ambicontig, vector<MessageValue> & msgs, int index, const DnaContext & dna)
 	{
-		ATGC_bitmap tmp;
+		ATGC_bitmap mer; //the bases of an ambiguous vertex
+		ATGC_view part; //the contig or vertex, in the orientation of the ambicontig
 		if(order[index].iscontig)
 		{
 			int result = find(msgs, order[index].vid);
 			if(result != -1)
 			{
-				if(order[index].isreverse)
-				{
-					tmp  = msgs[result].sequence.get_reverse();
-				}
-				else
-				{
-					tmp = msgs[result].sequence;
-				}
+				part = msgs[result].sequence.view(order[index].isreverse);
 			}
 		}
 		else
 		{
-			tmp.init(order[index].vid);
-			if(order[index].isreverse)
-			{
-				tmp = tmp.get_reverse();
-			}
-		}
-		if(index == 0)
-		{
-			for(int i = 0; i < tmp.length; i++)
-			{
-				ambicontig->seq.append(tmp.get(i));
-			}
-		}
-		else
-		{
-			for(int i = mer_length - 1; i < tmp.length; i++)
-			{
-				ambicontig->seq.append(tmp.get(i));
-			}
+			mer.init(order[index].vid, dna);
+			part = mer.view(order[index].isreverse);
 		}
+		if(index > 0) part = part.skip(dna.mer_length - 1); //the k-1 bases shared with the previous part
+		ambicontig->seq.append(part);
 	}
 
-	AmbiContig * get_ambicontig(vector<MessageValue> & msgs)
+	AmbiContig * get_ambicontig(vector<MessageValue> & msgs, const DnaContext & dna)
 	{
 		AmbiContig * ambicontig = new AmbiContig;
 		for(int i = 0; i < order.size(); i++)
 		{
-			merge_sequence(ambicontig, msgs, i);
+			merge_sequence(ambicontig, msgs, i, dna);
 		}
 		return ambicontig;
 	}
@@ -677,6 +666,9 @@ public:
 	typedef vector<Contig *> ContigVector;
 
 	int min_contig_length;
+	int line_width; //of the output FASTA, 0 = a sequence on one line
+	int gzip_level; //of the output FASTA, 0 = no gzip
+	DnaContext dna;
 	DefaultHash<k_mer> hash;
 	Groups groups;
 	GroupVector groupVec;
@@ -685,10 +677,13 @@ public:
 	ContigVector contigs;
 
 
-	AmbiMergeWorker(int k, int min_contig_len)
+	AmbiMergeWorker(int k, int min_contig_len, int line_width, int gzip_level)
 	{
-		set_mer_length(k);
+		dna.init(k);
+		set_stage_dna(dna);
 		min_contig_length = min_contig_len;
+		this->line_width = line_width;
+		this->gzip_level = gzip_level;
 	}
 
 	~AmbiMergeWorker()
@@ -788,40 +783,81 @@ public:
 		else
 		{
 			AmbiVertex * v = new AmbiVertex;
-			AmbiVSet* grp = new AmbiVSet;
 			k_mer pred = v->parse(line);
-			if(v->type == Vm_n)
-				ambiVec.push_back(v);
-			else
-			{
-				grp->id = pred;
-				grp->add(v);
-				add_group(grp);
-			}
+			add_ambi(v, pred);
+		}
+	}
+
+	void add_vertex(obinstream& m, int type) //type: REC_CONTIG or REC_AMBI_LINK
+	{
+		if(type == REC_CONTIG)
+		{
+			Contig * v = new Contig;
+			v->parse(m);
+			contigs.push_back(v);
+		}
+		else
+		{
+			AmbiVertex * v = new AmbiVertex;
+			k_mer pred = v->parse(m);
+			add_ambi(v, pred);
+		}
+	}
+
+	void add_ambi(AmbiVertex * v, k_mer pred)
+	{
+		if(v->type == Vm_n)
+			ambiVec.push_back(v);
+		else
+		{
+			AmbiVSet* grp = new AmbiVSet;
+			grp->id = pred;
+			grp->add(v);
+			add_group(grp);
 		}
 	}
 
+	void load_records(RecordReader & reader)
+	{
+		while (reader.next())
+			add_vertex(reader.in(), reader.type());
+	}
+
 	void load_vertices(const char* inpath)
 	{
 		hdfsFS fs = getHdfsFS();
 		hdfsFile in = getRHandle(inpath, fs);
-		LineReader reader(fs, in);
-		while (true)
+		if (binary_stage_io)
 		{
-			reader.readLine();
-			if (!reader.eof())
-				add_vertex(reader.getLine());
-			else
-				break;
+			RecordReader reader(fs, in, inpath);
+			load_records(reader);
+		}
+		else
+		{
+			LineReader reader(fs, in);
+			while (true)
+			{
+				reader.readLine();
+				if (!reader.eof())
+					add_vertex(reader.getLine());
+				else
+					break;
+			}
 		}
 		hdfsCloseFile(fs, in);
 		hdfsDisconnect(fs);
 	}
 
+	//loads the splits of "inpaths" dispatched by the master, and this rank's part of the in-memory stages
+	void load_inputs(const vector<string>& inpaths, bool native_dispatcher)
+	{
+		load_stage_inputs(this, &AmbiMergeWorker::load_vertices, &AmbiMergeWorker::load_records, inpaths, native_dispatcher);
+	}
+
 	void dump_partition(const char* outpath)
 	{
 		hdfsFS fs = getHdfsFS();
-		BufferedWriter* writer = new BufferedWriter(outpath, fs, _my_rank);
+		FastaWriter* writer = new FastaWriter(outpath, fs, _my_rank, line_width, gzip_level);
 		for(int i = 0; i < ambicontigs.size(); i++)
 		{
 			AmbiContig * cur = ambicontigs[i];
@@ -849,12 +885,12 @@ public:
 			//add the following function in the case that we used SV-alg in previous step,
 			//in that way, the group is not the head of this contig, we should find the head
 #ifdef SV_USED
-			k_mer head = cur->find_head_ambicontig();
-			k_mer tail = cur->find_tail_ambicontig();
+			k_mer head = cur->find_head_ambicontig(dna);
+			k_mer tail = cur->find_tail_ambicontig(dna);
 			if(head > tail) head = tail;
-			cur->reorder_ambiVSet(head);
+			cur->reorder_ambiVSet(dna, head);
 #else
-			cur->reorder_ambiVSet();
+			cur->reorder_ambiVSet(dna);
 #endif
 			//!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 			for(int j = 0; j < cur->order.size(); j++)
@@ -893,7 +929,7 @@ public:
 		for(int i = 0; i < groupVec.size(); i++)
 		{
 			AmbiVSet* cur = groupVec[i];
-			AmbiContig * tmp = cur->get_ambicontig(con_msgbufs[i]);
+			AmbiContig * tmp = cur->get_ambicontig(con_msgbufs[i], dna);
 			cur->free_members();
 			delete cur;
 			con_msgbufs[i].clear();
@@ -941,8 +977,7 @@ public:
 			{
 				AmbiContig * tmp = new AmbiContig;
 				MessageValue & msg = remain_msgbufs[i][j];
-				for(int k = 0; k < msg.sequence.length; k++)
-					tmp->seq.append(msg.sequence.get(k));
+				tmp->seq.swap(msg.sequence);
 				ambicontigs.push_back(tmp);
 			}
 			remain_msgbufs[i].clear();
@@ -971,28 +1006,7 @@ public:
 
 		//dispatch splits
 		ResetTimer(WORKER_TIMER);
-		vector<vector<string> >* arrangement;
-		if (_my_rank == MASTER_RANK)
-		{
-			arrangement = params.native_dispatcher ? dispatchLocality(params.input_paths) : dispatchRan(params.input_paths);
-			//reportAssignment(arrangement);//DEBUG !!!!!!!!!!
-			masterScatter(*arrangement);
-			vector<string>& assignedSplits = (*arrangement)[0];
-			//reading assigned splits (map)
-			for (vector<string>::iterator it = assignedSplits.begin();
-			        it != assignedSplits.end(); it++)
-				load_vertices(it->c_str());
-			delete arrangement;
-		}
-		else
-		{
-			vector<string> assignedSplits;
-			slaveScatter(assignedSplits);
-			//reading assigned splits (map)
-			for (vector<string>::iterator it = assignedSplits.begin();
-			        it != assignedSplits.end(); it++)
-				load_vertices(it->c_str());
-		}
+		load_inputs(params.input_paths, params.native_dispatcher);
 		StopTimer(WORKER_TIMER);
 		PrintTimer("Load Time", WORKER_TIMER);
 
@@ -1024,7 +1038,7 @@ public:
 	}
 };
 
-void AmbiMerge(string contig_path, string ambi_path, string out_path, int kmer, int min_contig_length)
+void AmbiMerge(string contig_path, string ambi_path, string out_path, int kmer, int min_contig_length, int line_width = 0, int gzip_level = 0)
 {
 	MultiInputParams ambmerge_p;
 	ambmerge_p.input_paths.push_back(contig_path);
@@ -1033,7 +1047,7 @@ void AmbiMerge(string contig_path, string ambi_path, string out_path, int kmer,
 	ambmerge_p.force_write=true;
 	ambmerge_p.native_dispatcher=false;
 	//	init_workers();
-	AmbiMergeWorker ambmerge(kmer, min_contig_length);
+	AmbiMergeWorker ambmerge(kmer, min_contig_length, line_width, gzip_level);
 	ambmerge.run(ambmerge_p);
 	//	worker_finalize();
 }
@@ -4,6 +4,7 @@
 #include "utils/type.h"
 #include "basic/DNAPregel-dev.h"
 #include "GlobalDna.h"
+#include "Minimizer.h"
 
 using namespace std;
 
@@ -39,20 +40,20 @@ obinstream & operator>>(obinstream & m,  AmbiSVValue & v)
 	return m;
 }
 
-class AmbiSVVertex: public Vertex<k_mer, AmbiSVValue, k_mer>
+class AmbiSVVertex: public Vertex<k_mer, AmbiSVValue, k_mer, MinimizerHash<k_mer> >
 {
 public:
 
 	inline k_mer is_contig_end(k_mer s) //return type treated as bool
 	{
-		return s >> (mer_length*2);
+		return s >> (stage_dna().mer_length*2);
 	}
 
 	void get_neighbors(vector<k_mer> & collector)
 	{
 		for(int i = 0; i < value().ambi_nbs.size(); i++)
 		{
-			collector.push_back(get_neighbor(id, value().ambi_nbs[i].nb_info));
+			collector.push_back(get_neighbor(id, value().ambi_nbs[i].nb_info, stage_dna()));
 		}
 		for(int i = 0; i< value().contig_nbs.size(); i++)
 		{
@@ -66,7 +67,7 @@ public:
 		//ambiguous vertices vote to halt; //unambiguous vertices set "preds" properly
 		if(value().type == V_1)
 		{
-			k_mer self = (id | END_MER);
+			k_mer self = (id | stage_dna().end_mer);
 			value().neighbors.push_back(self); //one pred is itself
 			//another is the only neighbor
 			if(msgs.size() == 1)
@@ -87,13 +88,13 @@ public:
 		{
 			if(msgs.size() == 2) //itself is a contig
 			{
-				k_mer self = (id | END_MER);
+				k_mer self = (id | stage_dna().end_mer);
 				value().neighbors.push_back(self);
 				value().neighbors.push_back(self);
 			}
 			else if(msgs.size() == 1)
 			{
-				k_mer self = (id | END_MER);
+				k_mer self = (id | stage_dna().end_mer);
 				value().neighbors.push_back(self);
 				//find the other neighbor
 				vector<k_mer> nbs;
@@ -109,7 +110,7 @@ public:
 			}
 			else //msgs.size() == 0
 			{
-				k_mer self = (id | END_MER);
+				k_mer self = (id | stage_dna().end_mer);
 				vector<k_mer> nbs;
 				get_neighbors(nbs);
 				if(nbs.size() == 0)
@@ -345,13 +346,14 @@ public:
 class AmbiSVWorker:public Worker<AmbiSVVertex, AmbiSVAgg>
 {
 	char buf[100];
+	DnaContext dna;
 
 public:
 
-	AmbiSVWorker(int k)
+	AmbiSVWorker(int k, int minimizer_len)
 	{
-		set_mer_length(k);
-		END_MER = 1ull << (2*mer_length);
+		dna.init(k, minimizer_len);
+		set_stage_dna(dna);
 	}
 
 	virtual AmbiSVVertex* toVertex(char* line)
@@ -393,6 +395,45 @@ public:
 		return v;
 	}
 
+	virtual AmbiSVVertex* toVertex(obinstream& m, int type) //REC_NOTIP
+	{
+		check_type(type, REC_NOTIP, "a TipRemoval output");
+		AmbiSVVertex* v=new AmbiSVVertex;
+		m >> v->id;
+		m >> v->value().type;
+		m >> v->value().ambi_nbs;
+		m >> v->value().contig_nbs;
+		v->value().prev_D = v->id;
+		v->value().D = v->id;
+		return v;
+	}
+
+	virtual int record_type(int output)
+	{
+		return REC_AMBI_LINK;
+	}
+
+	virtual void torecord(AmbiSVVertex* v, RecordWriter& writer)
+	{
+		AmbiSVValue & value = v->value();
+		k_mer pred;
+		if(value.type != Vm_n)
+		{
+			pred = value.D;
+		}
+		else
+		{
+			pred = NULL_MER;
+		}
+		writer.check();
+		writer.m << v->id;
+		writer.m << pred;
+		writer.m << value.type;
+		writer.m << value.ambi_nbs;
+		writer.m << value.contig_nbs;
+		writer.end_record();
+	}
+
 	virtual void toline(AmbiSVVertex* v, BufferedWriter& writer)
 	{
 		AmbiSVValue & value = v->value();
@@ -406,7 +447,7 @@ public:
 			pred = NULL_MER;
 		}
 		int size = value.ambi_nbs.size();
-		sprintf(buf, "%llu\t%llu %u %d", v->id, pred, value.type, size);
+		sprintf(buf, KMER_FMT "\t" KMER_FMT " %u %d", v->id, pred, value.type, size);
 		writer.write(buf);
 		//------
 		for(int i = 0; i < size; i++)
@@ -422,14 +463,14 @@ public:
 		for(int i = 0; i < size; i++)
 		{
 			ContigNB & nb = value.contig_nbs[i];
-			sprintf(buf, " %llu %u %llu %d", nb.nid, nb.ninfo.bitmap, nb.contigID, nb.length);
+			sprintf(buf, " " KMER_FMT " %u " KMER_FMT " %d", nb.nid, nb.ninfo.bitmap, nb.contigID, nb.length);
 			writer.write(buf);
 		}
 		writer.write(" #\n");
 	}
 };
 
-void AmbiSV(string in_path, string out_path, int length)
+void AmbiSV(string in_path, string out_path, int length, int minimizer_len = 0)
 {
 	WorkerParams param;
 	param.input_path=in_path;
@@ -437,7 +478,7 @@ void AmbiSV(string in_path, string out_path, int length)
 	param.force_write=true;
 	param.native_dispatcher=false;
 //	init_workers();
-	AmbiSVWorker worker(length);
+	AmbiSVWorker worker(length, minimizer_len);
 	AmbiSVAgg agg = AmbiSVAgg();
 	worker.setAggregator(&agg);
 	worker.run(param);
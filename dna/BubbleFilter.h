@@ -50,9 +50,9 @@ struct BubbleSet_hash
 		kmer_pair & group = x->group;
 		size_t seed = 0;
 		hash_combine(seed, group.v1);
-		hash_combine(seed, (group.v1 >> 32));
+		hash_combine(seed, (group.v1 >> (KMER_BITS / 2)));
 		hash_combine(seed, group.v2);
-		hash_combine(seed, (group.v2 >> 32));
+		hash_combine(seed, (group.v2 >> (KMER_BITS / 2)));
 		return seed;
 	}
 };
@@ -80,10 +80,12 @@ public:
 	ContigVector contigVec; //two parts: (1) dangling or long contigs (before shuffling), (2) non-filtered contigs (after shuffling)
 	int edist_threshold;
 	int len_threshold;
+	DnaContext dna;
 
 	BubbleWorker(int k, int edit_dist = 2, int length = 10000)
 	{
-		set_mer_length(k);
+		dna.init(k);
+		set_stage_dna(dna);
 		edist_threshold = edit_dist;
 		len_threshold = length;
 	}
@@ -108,6 +110,18 @@ public:
 	{
 		Contig * v = new Contig;
 		v->parse(line);
+		add_contig(v);
+	}
+
+	void add_vertex(obinstream& m)
+	{
+		Contig * v = new Contig;
+		v->parse(m);
+		add_contig(v);
+	}
+
+	void add_contig(Contig * v)
+	{
 		if(v->in_neighbor != NULL_MER && v->out_neighbor != NULL_MER)
 		{
 			BubbleSet* grp = new BubbleSet;
@@ -155,11 +169,11 @@ public:
 			for(int j=i+1; j<size; j++)
 			{
 				Contig * b = grp->members[j];
-				int editDis;
-				if( a->mark != b->mark)
-					editDis = (a->seq.length < b->seq.length) ? edist(a->seq.get_reverse(), b->seq) : edist(a->seq, b->seq.get_reverse());
-				else
-					editDis = edist(a->seq, b->seq);
+				//the shorter contig is the pattern, opposite marks compare with the reverse complement
+				bool a_shorter = a->seq.length < b->seq.length;
+				ATGC_view pattern = a_shorter ? a->seq.view() : b->seq.view();
+				ATGC_view text = a_shorter ? b->seq.view(a->mark != b->mark) : a->seq.view(a->mark != b->mark);
+				int editDis = edist_within(pattern, text, edist_threshold);
 				if( editDis <= edist_threshold)
 				{
 					if(a->freq > b->freq) prune[j] = true;
@@ -182,30 +196,59 @@ public:
 
 	//==============================
 
+	void load_records(RecordReader & reader)
+	{
+		while (reader.next())
+			add_vertex(reader.in());
+	}
+
 	void load_vertices(const char* inpath)
 	{
 		hdfsFS fs = getHdfsFS();
 		hdfsFile in = getRHandle(inpath, fs);
-		LineReader reader(fs, in);
-		while (true)
+		if (binary_stage_io)
+		{
+			RecordReader reader(fs, in, inpath);
+			load_records(reader);
+		}
+		else
 		{
-			reader.readLine();
-			if (!reader.eof())
-				add_vertex(reader.getLine());
-			else
-				break;
+			LineReader reader(fs, in);
+			while (true)
+			{
+				reader.readLine();
+				if (!reader.eof())
+					add_vertex(reader.getLine());
+				else
+					break;
+			}
 		}
 		hdfsCloseFile(fs, in);
 		hdfsDisconnect(fs);
 	}
 
+	//loads the splits of "inpaths" dispatched by the master, and this rank's part of the in-memory stages
+	void load_inputs(const vector<string>& inpaths, bool native_dispatcher)
+	{
+		load_stage_inputs(this, &BubbleWorker::load_vertices, &BubbleWorker::load_records, inpaths, native_dispatcher);
+	}
+
 	//for machine read
 	void dump_partition(const char* outpath)
 	{
 		hdfsFS fs = getHdfsFS();
-		BufferedWriter* writer = new BufferedWriter(outpath, fs, _my_rank);
-		for(int i = 0 ; i < contigVec.size(); i++) contigVec[i]->dumpTo(writer);
-		delete writer;
+		if (binary_stage_io)
+		{
+			RecordWriter* writer = new RecordWriter(outpath, fs, _my_rank, REC_CONTIG);
+			for(int i = 0 ; i < contigVec.size(); i++) contigVec[i]->dumpTo(writer);
+			delete writer;
+		}
+		else
+		{
+			BufferedWriter* writer = new BufferedWriter(outpath, fs, _my_rank);
+			for(int i = 0 ; i < contigVec.size(); i++) contigVec[i]->dumpTo(writer);
+			delete writer;
+		}
 		hdfsDisconnect(fs);
 	}
 
@@ -238,28 +281,7 @@ public:
 		init_timers();
 
 		ResetTimer(WORKER_TIMER);
-		vector<vector<string> >* arrangement;
-		if (_my_rank == MASTER_RANK)
-		{
-			arrangement = params.native_dispatcher ? dispatchLocality(params.input_path.c_str()) : dispatchRan(params.input_path.c_str());
-
-			masterScatter(*arrangement);
-			vector<string>& assignedSplits = (*arrangement)[0];
-
-			for (vector<string>::iterator it = assignedSplits.begin();
-			        it != assignedSplits.end(); it++)
-				load_vertices(it->c_str());
-			delete arrangement;
-		}
-		else
-		{
-			vector<string> assignedSplits;
-			slaveScatter(assignedSplits);
-
-			for (vector<string>::iterator it = assignedSplits.begin();
-			        it != assignedSplits.end(); it++)
-				load_vertices(it->c_str());
-		}
+		load_inputs(vector<string>(1, params.input_path), params.native_dispatcher);
 		StopTimer(WORKER_TIMER);
 		PrintTimer("Load Time", WORKER_TIMER);
 
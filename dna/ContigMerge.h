@@ -41,6 +41,25 @@ public:
 		return group;
 	}
 
+	k_mer parse(obinstream& m) //REC_KMER_LINK, same fields as the text line
+	{
+		//return group_id
+		k_mer group;
+		m >> id;
+		m >> group;
+		m >> type;
+		//------
+		m >> neighbor1.bitmap;
+		m >> count1;
+		//------
+		if(type == 2)
+		{
+			m >> neighbor2.bitmap;
+			m >> count2;
+		}
+		return group;
+	}
+
 	void order_edges()
 	{
 		if(!neighbor1.dead_end()) if(!neighbor1.is_in()) neighbor1.reverse();
@@ -115,7 +134,7 @@ public:
 		return m;
 	}
 
-	k_mer find_head_contig()
+	k_mer find_head_contig(const DnaContext & dna)
 	{
 		hash_map<k_mer, int> member_pos;
 		int count = members.size();
@@ -123,7 +142,7 @@ public:
 		ContigVertex * cur = members[member_pos[group]];
 		if(cur->type==1)
 			return cur->id;
-		k_mer nb = get_neighbor(cur->id, cur->neighbor1);
+		k_mer nb = get_neighbor(cur->id, cur->neighbor1, dna);
 		if(member_pos.find(nb) == member_pos.end())
 			return cur->id;
 		ContigVertex * pre = cur;
@@ -134,10 +153,10 @@ public:
 			{
 				return cur->id;
 			}
-			nb = get_neighbor(cur->id, cur->neighbor1);
+			nb = get_neighbor(cur->id, cur->neighbor1, dna);
 			if(nb == pre->id)
 			{
-				nb = get_neighbor(cur->id, cur->neighbor2);
+				nb = get_neighbor(cur->id, cur->neighbor2, dna);
 			}
 			if(member_pos.find(nb) == member_pos.end())
 			{
@@ -148,7 +167,7 @@ public:
 		return NULL_MER;
 	}
 
-	k_mer find_tail_contig()
+	k_mer find_tail_contig(const DnaContext & dna)
 	{
 		hash_map<k_mer, int> member_pos;
 		int count = members.size();
@@ -156,9 +175,9 @@ public:
 		ContigVertex * cur = members[member_pos[group]];
 		k_mer nb;
 		if(cur->type==1)
-			nb =  get_neighbor(cur->id, cur->neighbor1);
+			nb =  get_neighbor(cur->id, cur->neighbor1, dna);
 		else
-			nb = get_neighbor(cur->id, cur->neighbor2);
+			nb = get_neighbor(cur->id, cur->neighbor2, dna);
 		if(member_pos.find(nb) == member_pos.end())
 			return  cur->id;
 		ContigVertex * pre = cur;
@@ -169,10 +188,10 @@ public:
 			{
 				return  cur->id;
 			}
-			nb = get_neighbor(cur->id, cur->neighbor1);
+			nb = get_neighbor(cur->id, cur->neighbor1, dna);
 			if(nb == pre->id)
 			{
-				nb = get_neighbor(cur->id, cur->neighbor2);
+				nb = get_neighbor(cur->id, cur->neighbor2, dna);
 			}
 			if(member_pos.find(nb) == member_pos.end())
 			{
@@ -183,7 +202,7 @@ public:
 		return NULL_MER;
 	}
 
-	Contig* get_contig()
+	Contig* get_contig(const DnaContext & dna)
 	{
 		//"id" of returned contig is meaningless, will be set later
 		//remember to call free_members() after getting the contig (and then delete the current object itself)
@@ -210,7 +229,7 @@ public:
 		else
 		{
 			//pick a v{n-m}/dead_end neighbor as in-neighbor
-			k_mer nb_in = get_neighbor(cur->id, cur->neighbor1);
+			k_mer nb_in = get_neighbor(cur->id, cur->neighbor1, dna);
 			if(member_pos.find(nb_in) != member_pos.end())
 			{
 				//neighbor2 should be in-neighbor, swap two neighbors
@@ -224,7 +243,7 @@ public:
 			}
 			//!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 			//If the contig is a loop, the neighbor1 of the first node also can be one of the members
-			nb_in = get_neighbor(cur->id, cur->neighbor1);
+			nb_in = get_neighbor(cur->id, cur->neighbor1, dna);
 			if(member_pos.find(nb_in) != member_pos.end())
 			{
 				cur->neighbor1.bitmap =  DEAD_END;
@@ -236,11 +255,11 @@ public:
 		ContigVertex * pre = cur;
 		for(int i=1; i<count; i++)
 		{
-			k_mer curID = get_neighbor(pre->id, pre->neighbor2);
+			k_mer curID = get_neighbor(pre->id, pre->neighbor2, dna);
 			cur = members[member_pos[curID]];
 			reordered[i] = cur;
 			//--- to make "pre" as "neighbor1"
-			k_mer nb1_ID = get_neighbor(curID, cur->neighbor1);
+			k_mer nb1_ID = get_neighbor(curID, cur->neighbor1, dna);
 			if(nb1_ID != pre->id)
 			{
 				neighbor_info tmp = cur->neighbor1;
@@ -267,7 +286,7 @@ public:
 			{
 				//!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 				//Also should consider the loop-contig case for the last node's neighbor
-				k_mer nb_out = get_neighbor(cur->id, cur->neighbor2);
+				k_mer nb_out = get_neighbor(cur->id, cur->neighbor2, dna);
 				if(member_pos.find(nb_out) != member_pos.end())
 				{
 					cur->neighbor2.bitmap =  DEAD_END;
@@ -281,7 +300,7 @@ public:
 		neighbor_info & left_end = reordered.front()->neighbor1;
 		if(!left_end.dead_end())
 		{
-			contig->in_neighbor = get_neighbor(reordered.front()->id, left_end);
+			contig->in_neighbor = get_neighbor(reordered.front()->id, left_end, dna);
 			contig->in_pol = left_end.left_isH();
 			contig-> in_count = reordered.front()->count1;
 		}
@@ -295,7 +314,7 @@ public:
 		neighbor_info & right_end = reordered.back()->neighbor2;
 		if(!right_end.dead_end())
 		{
-			contig->out_neighbor = get_neighbor(reordered.back()->id, right_end);
+			contig->out_neighbor = get_neighbor(reordered.back()->id, right_end, dna);
 			contig->out_pol = right_end.right_isH();
 			contig->out_count = reordered.back()->count2;
 		}
@@ -310,8 +329,9 @@ public:
 		bool pol; //whether first vertex is H?
 		if(!left_end.dead_end()) pol = left_end.right_isH(); //look at in-edge
 		else pol = reordered.front()->neighbor2.left_isH(); //look at out-edge
-		if(pol) seq.init(getRC(reordered.front()->id)); //first vertex is H
-		else seq.init(reordered.front()->id); //first vertex is L
+		if(pol) seq.init(getRC(reordered.front()->id, dna), dna); //first vertex is H
+		else seq.init(reordered.front()->id, dna); //first vertex is L
+		seq.reserve(dna.mer_length + count - 1); //one more base per vertex
 		u32 min_freq = UINT_MAX;
 		for(int i=1; i<count; i++)
 		{
@@ -320,7 +340,7 @@ public:
 			pol = v->neighbor1.right_isH(); //look at in-edge
 			if(pol)
 			{
-				k_mer to_append = v->id >> (mer_length*2 -2);
+				k_mer to_append = v->id >> (dna.mer_length*2 -2);
 				seq.append(to_append ^ 3ull); //complement of first tag
 			}
 			else seq.append(v->id & 3ull); //last tag
@@ -355,7 +375,6 @@ bool ContigVSort( ContigVSet* m1,  ContigVSet* m2)
 }
 
 //=======================================
-static int tip_threshold;
 
 class ContigWorker
 {
@@ -369,10 +388,13 @@ public:
 	Groups groups;
 	GroupVector groupVec;
 	ContigVector contigs;
+	DnaContext dna;
+	int tip_threshold;
 
 	ContigWorker(int k, int tip_length = 0)
 	{
-		set_mer_length(k);
+		dna.init(k);
+		set_stage_dna(dna);
 		tip_threshold = tip_length;
 	}
 
@@ -401,6 +423,15 @@ public:
 		add_group(grp);
 	}
 
+	void add_vertex(obinstream& m)
+	{
+		ContigVertex * v = new ContigVertex;
+		ContigVSet* grp = new ContigVSet;
+		grp->group = v->parse(m);
+		grp->add(v);
+		add_group(grp);
+	}
+
 	void sync_groups()
 	{
 		//distribute groups to sending buffers
@@ -429,18 +460,32 @@ public:
 
 	//==============================
 
+	void load_records(RecordReader & reader)
+	{
+		while (reader.next())
+			add_vertex(reader.in());
+	}
+
 	void load_vertices(const char* inpath)
 	{
 		hdfsFS fs = getHdfsFS();
 		hdfsFile in = getRHandle(inpath, fs);
-		LineReader reader(fs, in);
-		while (true)
+		if (binary_stage_io)
 		{
-			reader.readLine();
-			if (!reader.eof())
-				add_vertex(reader.getLine());
-			else
-				break;
+			RecordReader reader(fs, in, inpath);
+			load_records(reader);
+		}
+		else
+		{
+			LineReader reader(fs, in);
+			while (true)
+			{
+				reader.readLine();
+				if (!reader.eof())
+					add_vertex(reader.getLine());
+				else
+					break;
+			}
 		}
 		hdfsCloseFile(fs, in);
 		hdfsDisconnect(fs);
@@ -454,6 +499,15 @@ public:
 		//in_nb/out_nb = (nb_id, pol, count) or (NULL_MER, 0, 0)
 		//seq = (length num_bytes byte1 byte2 ...)
 		hdfsFS fs = getHdfsFS();
+		if (binary_stage_io)
+		{
+			RecordWriter* writer = new RecordWriter(outpath, fs, _my_rank, REC_CONTIG);
+			for(int i = 0; i < contigs.size(); i++)
+				contigs[i]->dumpTo(writer);
+			delete writer;
+			hdfsDisconnect(fs);
+			return;
+		}
 		BufferedWriter* writer = new BufferedWriter(outpath, fs, _my_rank);
 		for(int i = 0; i < contigs.size(); i++)
 		{
@@ -463,6 +517,12 @@ public:
 		delete writer;
 		hdfsDisconnect(fs);
 	}
+
+	//loads the splits of "inpaths" dispatched by the master, and this rank's part of the in-memory stages
+	void load_inputs(const vector<string>& inpaths, bool native_dispatcher)
+	{
+		load_stage_inputs(this, &ContigWorker::load_vertices, &ContigWorker::load_records, inpaths, native_dispatcher);
+	}
 	//*/
 
 
@@ -497,28 +557,7 @@ public:
 
 		//dispatch splits
 		ResetTimer(WORKER_TIMER);
-		vector<vector<string> >* arrangement;
-		if (_my_rank == MASTER_RANK)
-		{
-			arrangement = params.native_dispatcher ? dispatchLocality(params.input_path.c_str()) : dispatchRan(params.input_path.c_str());
-			//reportAssignment(arrangement);//DEBUG !!!!!!!!!!
-			masterScatter(*arrangement);
-			vector<string>& assignedSplits = (*arrangement)[0];
-			//reading assigned splits (map)
-			for (vector<string>::iterator it = assignedSplits.begin();
-			        it != assignedSplits.end(); it++)
-				load_vertices(it->c_str());
-			delete arrangement;
-		}
-		else
-		{
-			vector<string> assignedSplits;
-			slaveScatter(assignedSplits);
-			//reading assigned splits (map)
-			for (vector<string>::iterator it = assignedSplits.begin();
-			        it != assignedSplits.end(); it++)
-				load_vertices(it->c_str());
-		}
+		load_inputs(vector<string>(1, params.input_path), params.native_dispatcher);
 		StopTimer(WORKER_TIMER);
 		PrintTimer("Load Time", WORKER_TIMER);
 
@@ -539,17 +578,26 @@ public:
 		for(int i = 0; i < groupVec.size(); i++)
 		{
 			ContigVSet* cur = groupVec[i];
-			k_mer head = cur->find_head_contig();
-			k_mer tail = cur->find_tail_contig();
+			k_mer head = cur->find_head_contig(dna);
+			k_mer tail = cur->find_tail_contig(dna);
 			cur->group = (head > tail) ? tail : head;
 		}
 #endif
 		sort(groupVec.begin(), groupVec.end(), ContigVSort);
 
+		//contig id: NULL_MER | rank | i, the rank field has just enough bits for _num_workers, i gets the rest
+		int rank_bits = 0;
+		while((1LL << rank_bits) < _num_workers) rank_bits++;
+		int idx_bits = KMER_BITS - 1 - rank_bits;
+		if(idx_bits < 1)
+		{
+			fprintf(stderr, "Too many workers (%d) for KMER_BITS = %d!\n", _num_workers, KMER_BITS);
+			exit(-1);
+		}
 		for(int i = 0; i < groupVec.size(); i++)
 		{
 			ContigVSet* cur = groupVec[i];
-			Contig * tmp = cur->get_contig();
+			Contig * tmp = cur->get_contig(dna);
 			cur->free_members();
 			delete cur;
 			if( (tmp->seq.length <= tip_threshold) && ((tmp->in_neighbor == NULL_MER) || (tmp->out_neighbor == NULL_MER)) )
@@ -558,8 +606,13 @@ public:
 				continue;
 			}
 			//set id
+			if((k_mer)i >> idx_bits)
+			{
+				fprintf(stderr, "Too many contigs on worker %d for KMER_BITS = %d!\n", _my_rank, KMER_BITS);
+				exit(-1);
+			}
 			tmp->id = _my_rank;
-			tmp->id <<= 32;
+			tmp->id <<= idx_bits;
 			tmp->id |= (NULL_MER | i);
 			contigs.push_back(tmp);
 		}
@@ -0,0 +1,82 @@
+#ifndef COUNTMINSKETCH_H
+#define COUNTMINSKETCH_H
+
+#include <vector>
+#include "utils/communication.h"
+#include "GlobalDna.h"
+#include "KmerTable.h"
+using namespace std;
+
+//====================================
+//count-min sketch over k_mer ids, replicated on all workers
+//"counts" holds the increments of all workers up to the last sync(), "delta" the increments of this worker since then,
+//so a worker sees its own increments at once, and those of the other workers after each sync()
+class CountMinSketch
+{
+public:
+	static const int DEPTH = 4;
+
+	vector<u32> counts;
+	vector<u32> delta;
+	u64 width; //counters per row
+
+	CountMinSketch()
+	{
+		width = 0;
+	}
+
+	void init(u64 num_counters)
+	{
+		width = num_counters / DEPTH;
+		if(width == 0)
+			width = 1;
+		vector<u32>(width * DEPTH, 0).swap(counts);
+		vector<u32>(width * DEPTH, 0).swap(delta);
+	}
+
+	void clear() //releases the memory
+	{
+		vector<u32>().swap(counts);
+		vector<u32>().swap(delta);
+	}
+
+	//the counter of "id" in row i, by double hashing
+	inline u64 position(u64 h, int i)
+	{
+		u64 h1 = h & 0xFFFFFFFF;
+		u64 h2 = (h >> 32) | 1;
+		return i * width + (h1 + i * h2) % width;
+	}
+
+	u32 estimate(k_mer id)
+	{
+		u64 h = kmer_mix(id);
+		u32 est = (u32)-1;
+		for(int i = 0; i < DEPTH; i++)
+		{
+			u64 pos = position(h, i);
+			u32 c = counts[pos] + delta[pos];
+			if(c < est)
+				est = c;
+		}
+		return est;
+	}
+
+	void add(k_mer id)
+	{
+		u64 h = kmer_mix(id);
+		for(int i = 0; i < DEPTH; i++)
+			delta[position(h, i)]++;
+	}
+
+	//adds the increments of all workers, all workers must call it together
+	void sync()
+	{
+		all_sum_words(&delta[0], delta.size());
+		for(size_t i = 0; i < counts.size(); i++)
+			counts[i] += delta[i];
+		fill(delta.begin(), delta.end(), 0);
+	}
+};
+
+#endif
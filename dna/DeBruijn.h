@@ -3,71 +3,290 @@
 
 #include <vector>
 #include <string>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "utils/time.h"
 #include "utils/global.h"
 #include "utils/communication.h"
 #include "utils/serialization.h"
 #include "utils/hdfs_core.h"
+#include "utils/seq_reader.h"
+#include "utils/packed_reads.h"
 #include "utils/combiner.h"
 #include "utils/aggregator.h"
 #include "utils/type.h"
 #include "basic/Vertex.h"
 #include "GlobalDna.h"
+#include "KmerTable.h"
+#include "KmerBloom.h"
+#include "Minimizer.h"
+#include "CountMinSketch.h"
 using namespace std;
 
-k_mer ALL_A, ALL_C, ALL_G, ALL_T;
+//char -> 2-bit code, NOT_ATGC for 'N' and any other non-base char
+static const u8 NOT_ATGC = 4;
+u8 ATGC_code[256];
+
+void set_ATGC_code()
+{
+	for(int i = 0; i < 256; i++) ATGC_code[i] = NOT_ATGC;
+	ATGC_code['A'] = (u8)A;
+	ATGC_code['T'] = (u8)T;
+	ATGC_code['G'] = (u8)G;
+	ATGC_code['C'] = (u8)C;
+}
 
 //====================================
-class KPlus_mer
+//rolling encoder of the k+1 mers of a read
+//fwd is the k+1 mer as it appears in the read, rc is its reverse complement
+//both are updated in O(1) per base, so the canonical k+1 mer is min(fwd, rc)
+//(2-bit codes keep the ASCII order of A < C < G < T, so this equals the old strncmp() order)
+struct KPlusRoller
 {
-public:
-	k_mer id;
-	u8 count;
+	k_mer fwd;
+	k_mer rc;
+	k_mer mask; //kick for k+1 mers
+	k_mer kick; //for k mers
+	int mer_length;
+	int rc_shift; //position of the first base in rc
+	int valid; //number of consecutive ATGC bases seen so far, capped at k+1
 
-	KPlus_mer()
+	KPlusRoller(const DnaContext & dna)
 	{
-		id = 0;
-		count = 0;
+		mer_length = dna.mer_length;
+		kick = dna.kick;
+		mask = 0xFFFFFFFFFFFFFFFF >> (64 - 2 * (mer_length + 1));
+		rc_shift = 2 * mer_length;
+		reset();
+	}
+
+	inline void reset()
+	{
+		fwd = 0;
+		rc = 0;
+		valid = 0;
+	}
+
+	//returns true if the last k+1 bases form a valid k+1 mer
+	inline bool push(char c)
+	{
+		k_mer code = ATGC_code[(u8)c];
+		if(code == NOT_ATGC)
+		{
+			reset(); //'N' breaks the read
+			return false;
+		}
+		return push_code(code);
+	}
+
+	inline bool push_code(k_mer code)
+	{
+		fwd = ((fwd << 2) | code) & mask;
+		rc = (rc >> 2) | ((code ^ 3ull) << rc_shift);
+		if(valid <= mer_length) valid++;
+		return valid > mer_length;
+	}
+
+	inline k_mer canonical()
+	{
+		return (fwd < rc) ? fwd : rc;
+	}
+
+	//canonical id of the left k mer, whose reverse complement is the right end of rc
+	inline k_mer left_vertex()
+	{
+		k_mer vid = fwd >> 2;
+		k_mer vid_rc = rc & kick;
+		return (vid < vid_rc) ? vid : vid_rc;
+	}
+
+	//canonical id of the right k mer, whose reverse complement is the left end of rc
+	inline k_mer right_vertex()
+	{
+		k_mer vid = fwd & kick;
+		k_mer vid_rc = rc >> 2;
+		return (vid < vid_rc) ? vid : vid_rc;
+	}
+};
+
+//====================================
+//rolling minimizer of the k+1 mers of a read, pushed with the same bases as KPlusRoller
+//keeps the orders of the last "window" m-mers in a ring, and rescans the ring only when
+//the current minimum slides out of the window
+struct MinimizerRoller
+{
+	k_mer fwd; //current m-mer
+	k_mer rc;
+	k_mer mask;
+	int rc_shift;
+	int m; //minimizer length
+	int valid; //number of consecutive ATGC bases seen so far, capped at m
+	int window; //m-mers per k+1 mer
+	u64 orders[MAX_MER_LENGTH + 1];
+	long long num; //m-mers pushed since the last reset
+	long long min_num; //index of the current minimum
+	u64 min_order;
+
+	MinimizerRoller(const DnaContext & dna)
+	{
+		m = dna.minimizer_len;
+		mask = ((k_mer)-1) >> (8 * sizeof(k_mer) - 2 * m);
+		rc_shift = 2 * (m - 1);
+		window = dna.mer_length + 2 - m;
+		reset();
 	}
 
-	//operations on vid
-	void append2id(char c)
+	inline void reset()
 	{
-		id <<= 2;
-		if (c == 'T')
-			id |= 3ull;
-		else if (c == 'G')
-			id |= 2ull;
-		else if (c == 'C')
-			id |= 1ull;
+		fwd = 0;
+		rc = 0;
+		valid = 0;
+		num = 0;
 	}
 
-	void id2canonical(char * buf)
+	inline void push(char c)
 	{
-		char rev[mer_length + 1];
-		for (int i = 0; i < mer_length + 1; i++)
+		k_mer code = ATGC_code[(u8)c];
+		if(code == NOT_ATGC)
 		{
-			char tmp = buf[mer_length - i];
-			if (tmp == 'A')
-				rev[i] = 'T';
-			else if (tmp == 'T')
-				rev[i] = 'A';
-			else if (tmp == 'G')
-				rev[i] = 'C';
-			else if (tmp == 'C')
-				rev[i] = 'G';
+			reset();
+			return;
 		}
-		if (strncmp(buf, rev, mer_length + 1) < 0)
+		push_code(code);
+	}
+
+	inline void push_code(k_mer code)
+	{
+		fwd = ((fwd << 2) | code) & mask;
+		rc = (rc >> 2) | ((code ^ 3ull) << rc_shift);
+		if(valid < m) valid++;
+		if(valid < m) return;
+		//------
+		u64 order = mmer_order(fwd, rc);
+		orders[num % window] = order;
+		if(num == 0 || order <= min_order)
 		{
-			for (int i = 0; i < mer_length + 1; i++)
-				append2id(buf[i]);
+			min_order = order;
+			min_num = num;
 		}
-		else
+		else if(num - min_num >= window)
+		{
+			min_order = order;
+			min_num = num;
+			for(long long i = num - window + 1; i < num; i++)
+			{
+				if(orders[i % window] < min_order)
+				{
+					min_order = orders[i % window];
+					min_num = i;
+				}
+			}
+		}
+		num++;
+	}
+
+	//minimizer order of the current k+1 mer, valid when KPlusRoller::push() returns true
+	inline u64 minimum()
+	{
+		return min_order;
+	}
+};
+
+//super k+1 mers of minimizer mode, packed one after another:
+//a word with the number of bases n in the low 32 bits and the occurrences of the super k+1 mer in the high 32 bits,
+//then (n + 31) / 32 words of 2-bit bases, the first base in the highest bits
+typedef vector<u64> SuperKmerBuffer;
+
+inline u64 super_kmer_head(u64 n, u32 count)
+{
+	return ((u64)count << 32) | n;
+}
+
+void pack_super_kmer(const char* start, const char* end, SuperKmerBuffer & buf, u32 count)
+{
+	u64 n = end - start;
+	buf.push_back(super_kmer_head(n, count));
+	u64 word = 0;
+	for(u64 j = 0; j < n; j++)
+	{
+		word = (word << 2) | ATGC_code[(u8)start[j]];
+		if((j & 31) == 31)
+		{
+			buf.push_back(word);
+			word = 0;
+		}
+	}
+	if(n & 31)
+		buf.push_back(word << (2 * (32 - (n & 31))));
+}
+
+//same as pack_super_kmer(), for the n bases from base "pos" of packed words (see packed_reads.h)
+void pack_super_kmer_bits(const u64* words, u64 pos, u64 n, SuperKmerBuffer & buf)
+{
+	buf.push_back(super_kmer_head(n, 1));
+	const u64* w = words + (pos >> 5);
+	int offset = pos & 31;
+	for(u64 j = 0; j < n; j += 32, w++)
+	{
+		u64 num = (n - j < 32) ? n - j : 32; //bases of this word
+		u64 word = w[0] << (2 * offset);
+		if(offset > 0 && num > 32 - offset)
+			word |= w[1] >> (64 - 2 * offset);
+		if(num < 32)
+			word &= ~0ull << (2 * (32 - num));
+		buf.push_back(word);
+	}
+}
+
+//yields the 2-bit bases of packed words one by one from base "first" on,
+//a word is loaded once per 32 bases and no character is decoded
+struct PackedCursor
+{
+	const u64* w;
+	u64 word;
+	int left; //bases left in "word"
+
+	PackedCursor(const u64* words, u64 first)
+	{
+		w = words + (first >> 5);
+		word = w[0] << (2 * (first & 31));
+		left = 32 - (first & 31);
+	}
+
+	inline k_mer next()
+	{
+		if(left == 0)
 		{
-			for (int i = 0; i < mer_length + 1; i++)
-				append2id(rev[i]);
+			word = *++w;
+			left = 32;
 		}
+		k_mer code = (k_mer)(word >> 62);
+		word <<= 2;
+		left--;
+		return code;
+	}
+};
+
+//====================================
+class KPlus_mer
+{
+public:
+	k_mer id;
+	u32 count; //0 marks a free slot in KPlusTable
+
+	KPlus_mer()
+	{
+		id = 0;
+		count = 0;
+	}
+
+	inline bool empty()
+	{
+		return count == 0;
 	}
 
 	inline k_mer get_left_kmer()
@@ -75,14 +294,14 @@ public:
 		return (id >> 2);
 	}
 
-	inline k_mer get_right_kmer()
+	inline k_mer get_right_kmer(const DnaContext & dna)
 	{
-		return (id & kick);//kick out highest two bits
+		return (id & dna.kick);//kick out highest two bits
 	}
 
-	inline u32 get_leftmost()
+	inline u32 get_leftmost(const DnaContext & dna)
 	{
-		return (u32)(id >> 2 * mer_length);
+		return (u32)(id >> 2 * dna.mer_length);
 	}
 
 	inline u32 get_rightmost()
@@ -105,35 +324,84 @@ public:
 	}
 };
 
-//k+1 mer Key Order  =====================
-//for defining hash_set<k+1 mer>
-struct vid_hash_kplus
+typedef KmerTable<KPlus_mer> KPlusTable;
+
+//====================================
+//a block of reads, from the reader thread to the parser threads
+struct ReadBlock
 {
-	size_t operator()(KPlus_mer* x) const
+	bool is_packed;
+	string text; //complete lines separated by '\n'
+	PackedBlock packed; //a block of a split in the packed read format
+
+	ReadBlock(bool packed_block)
 	{
-		return x->id;
+		is_packed = packed_block;
 	}
 };
 
-struct vid_equal_kplus
+//bounded queue of read blocks, from the reader thread to the parser threads
+struct ReadBlockQueue
 {
-public:
-	bool operator()(KPlus_mer* a, KPlus_mer* b) const
+	deque<ReadBlock*> blocks;
+	size_t capacity;
+	bool closed;
+	mutex mtx;
+	condition_variable not_empty;
+	condition_variable not_full;
+
+	ReadBlockQueue(size_t cap)
 	{
-		if (a->id == b->id)
-			return true;
-		else
-			return false;
+		capacity = cap;
+		closed = false;
+	}
+
+	void push(ReadBlock* block)
+	{
+		unique_lock<mutex> lock(mtx);
+		while(blocks.size() >= capacity)
+			not_full.wait(lock);
+		blocks.push_back(block);
+		not_empty.notify_one();
+	}
+
+	//returns NULL when the queue is closed and drained
+	ReadBlock* pop()
+	{
+		unique_lock<mutex> lock(mtx);
+		while(blocks.empty() && !closed)
+			not_empty.wait(lock);
+		if(blocks.empty())
+			return NULL;
+		ReadBlock* block = blocks.front();
+		blocks.pop_front();
+		not_full.notify_one();
+		return block;
+	}
+
+	void close()
+	{
+		unique_lock<mutex> lock(mtx);
+		closed = true;
+		not_empty.notify_all();
 	}
 };
 //====================================
 
+//edge accumulator of a vertex, kept inline in a VertexTable
+//counts[i] is the count of the i-th set bit of "bitmap", from bit 31 down to bit 0, which is the order of
+//the freqs written by dump_vertices(), so adding an edge costs a popcount and a shift,
+//and the counts are vint-encoded only when the vertex is dumped
+//a vertex has at most 8 neighbors, and one k+1 mer sets at most 2 bits of a vertex (if its two k mers are
+//reverse complements), so at most 16 bits are set
 class DNAVertex
 {
 public:
+	static const int MAX_EDGES = 16;
+
 	k_mer id;
-	u32 bitmap; //four bytes, each for LL, LH, HL, and HH
-	vector<u8> freqs;
+	u32 bitmap; //four bytes, each for LL, LH, HL, and HH; 0 marks a free slot in VertexTable
+	u32 counts[MAX_EDGES];
 
 	DNAVertex()
 	{
@@ -141,27 +409,63 @@ public:
 		bitmap = 0;
 	}
 
-	void set_edgeBit(u32 tag, bool is_in, int shift)
+	inline bool empty()
+	{
+		return bitmap == 0;
+	}
+
+	inline int num_edges() const
+	{
+		return __builtin_popcount(bitmap);
+	}
+
+	//"bit" is a single edge bit of the bitmap
+	inline void add_edge(u32 bit, u32 count)
+	{
+		int pos = __builtin_popcount(bitmap & ~((bit << 1) - 1)); //set bits above "bit"
+		if(bitmap & bit)
+		{
+			counts[pos] += count;
+			return;
+		}
+		int num = num_edges();
+		if(num == MAX_EDGES)
+		{
+			fprintf(stderr, "vertex " KMER_FMT " has more than %d edges!\n", id, MAX_EDGES);
+			exit(-1);
+		}
+		for(int i = num; i > pos; i--)
+			counts[i] = counts[i - 1];
+		counts[pos] = count;
+		bitmap |= bit;
+	}
+
+	void set_edgeBit(u32 tag, bool is_in, int shift, u32 count)
 	{
 		tag = bit_pos[tag];
 		if(is_in)
 			tag <<= 4;
-		bitmap |= (tag << shift);
+		add_edge(tag << shift, count);
 	}
 
-	bool vid2canonical(k_mer vid)
+	void merge(DNAVertex & other)
 	{
-		k_mer rc = getRC(vid);
-
-		if(rc > vid)
+		u32 rest = other.bitmap;
+		for(int i = 0; rest != 0; i++)
 		{
-			id = vid;
-			return false;
+			u32 bit = 1u << (31 - __builtin_clz(rest)); //highest set bit
+			add_edge(bit, other.counts[i]);
+			rest ^= bit;
 		}
-		else
+	}
+
+	void get_freqs(vector<u8> & freqs)
+	{
+		freqs.clear();
+		int num = num_edges();
+		for(int i = 0; i < num; i++)
 		{
-			id = rc;
-			return true;
+			append_vint(freqs, counts[i]);
 		}
 	}
 
@@ -169,7 +473,9 @@ public:
 	{
 		m << v.id;
 		m << v.bitmap;
-		m << v.freqs;
+		int num = v.num_edges();
+		for(int i = 0; i < num; i++)
+			m << v.counts[i];
 		return m;
 	}
 
@@ -177,386 +483,1814 @@ public:
 	{
 		m >> v.id;
 		m >> v.bitmap;
-		m >> v.freqs;
+		int num = v.num_edges();
+		for(int i = 0; i < num; i++)
+			m >> v.counts[i];
 		return m;
 	}
 };
 
-//DNA Key Order  =====================
-//for defining hash_set<DNAVertex>
-struct vid_hash
+//canonical id of "vid", returns true if it is the reverse complement
+inline bool vid2canonical(k_mer vid, k_mer & id, const DnaContext & dna)
 {
-	size_t operator()(DNAVertex* x) const
+	k_mer rc = getRC(vid, dna);
+	if(rc > vid)
 	{
-		return x->id;
+		id = vid;
+		return false;
 	}
-};
+	id = rc;
+	return true;
+}
+
+typedef KmerTable<DNAVertex> VertexTable;
+//====================================
+//options of De Bruijn graph construction, named as in the ini (see PPA_Assembler_conf.ini)
 
-struct vid_equal
+struct DeBruijnOptions
 {
-public:
-	bool operator()(DNAVertex* a,  DNAVertex* b) const
+	int k_mer_t;
+	int minimizer_t; //0 = hash placement
+	int freq_t;
+	int num_threads; //parser threads per worker
+	int mem_budget_mb; //0 = single pass
+	int bloom_mb; //0 = no Bloom pre-filter
+	int stream_cache_mb; //0 = shuffle after parsing
+	bool dedup_reads;
+	int normalize_c; //0 = no normalization
+	int normalize_mb;
+	int correct_mb; //0 = no read correction
+	string store_path; //the k+1 mer count store to write, empty = none
+	string base_store_path; //incremental mode: the count store of the earlier reads, empty = none
+
+	DeBruijnOptions()
 	{
-		if(a->id == b->id)
-			return true;
-		else
-			return false;
+		k_mer_t = 21;
+		minimizer_t = 0;
+		freq_t = 1;
+		num_threads = 1;
+		mem_budget_mb = 0;
+		bloom_mb = 0;
+		stream_cache_mb = 0;
+		dedup_reads = false;
+		normalize_c = 0;
+		normalize_mb = 64;
+		correct_mb = 0;
 	}
 };
+
 //====================================
 
 class DeBruijn
 {
 public:
-	typedef hash_set<DNAVertex*, vid_hash, vid_equal> VertexContainer;
-	typedef VertexContainer::iterator VertexIter;
-	typedef vector<DNAVertex*> VertexVector;
+	typedef vector<DNAVertex> VertexVector;
+
+	typedef vector<KPlus_mer> KPlusVector;
 
-	typedef hash_set<KPlus_mer*, vid_hash_kplus, vid_equal_kplus> KPlusContainer;
-	typedef KPlusContainer::iterator KPlusIter;
-	typedef vector<KPlus_mer*> KPlusVector;
+	//bytes held per distinct k+1 mer of a pass: counting tables, shuffle buffers and vertices
+	static const long long KPLUS_MEM_BYTES = 200;
+	//assumed compression ratio of gzipped reads, for sizing the passes
+	static const long long GZIP_RATIO = 4;
+	static const int STREAM_POLL_READS = 256; //reads parsed between two polls of the stream
+	static const int STREAM_MAX_PENDING = 2; //unfinished stream sends per destination worker
+	static const long long NORM_BATCH_READS = 100000; //reads between two syncs of the normalization sketch
+	static const int STORE_GROUP_SIZE = 4096; //k+1 mers per record of the count store
 
 	int freq_threshold;
-	DefaultHash<k_mer> hash;
-	VertexContainer vertexes;
-	KPlusContainer kplus_mers;
+	int num_threads; //parser threads per worker, 1 = parse on the main thread
+	int mem_budget_mb; //memory budget per worker for counting, 0 = no limit (single pass)
+	int num_passes; //vertices are built in slices, one slice per pass over the input
+	int cur_pass;
+	int bloom_mb; //size of each filter of the Bloom pre-filter per worker, 0 = no pre-filter (see build_solid_filter())
+	bool bloom_pass; //true while the pre-filter pass is reading the input
+	int stream_cache_mb; //size of the pre-combining caches of streaming mode per worker, 0 = no streaming
+	StreamChannel* stream; //not NULL while a counting pass streams
+	size_t stream_cap; //entries (words in minimizer mode) of a cache that trigger its flush
+	vector<KPlusTable> stream_cache; //[destination worker], unused in minimizer mode
+	bool dedup; //reads are deduplicated before counting
+	int norm_coverage; //target coverage of digital normalization, 0 = no normalization
+	int norm_mb; //size of the count-min sketch of normalization per worker
+	string unique_reads; //reads to count kept by this worker, separated by '\n', used if reads_in_memory()
+	vector<u32> read_counts; //occurrences of each of them
+	CountMinSketch norm_sketch;
+	vector<k_mer> norm_ids; //k+1 mers of the current read
+	vector<u32> norm_ests; //their estimated counts
+	long long norm_batch; //reads since the last sync of the sketch
+	long long num_reads; //reads taken by prepare_reads()
+	long long num_kept; //reads kept by normalization
+	vector<string> dedup_parts; //[owner worker], reads to deduplicate
+	int correct_mb; //size of the filter of trusted k+1 mers for read correction per worker, 0 = no correction
+	KmerBloom trusted; //solid k+1 mers over all workers, used by read correction
+	string store_path; //the k+1 mer counts are also written to this path (see DeBruijn_FromStore()), empty = no store
+	RecordWriter* store_writer; //not NULL while the count store is written
+	string base_store_path; //incremental mode: the counts of the earlier reads, empty = no earlier reads
+	vector<string> base_splits; //files of base_store_path assigned to this worker
+	string rc_buf;
+	KmerBloom seen_once; //bits set by any k+1 mer
+	KmerBloom seen_twice; //bits set again by a later k+1 mer
+	KmerBloom solid; //k+1 mers that may occur at least twice over all workers
+	DefaultHash<k_mer> kplus_hash; //owner of a k+1 mer, kplus_owner() in minimizer mode
+	MinimizerHash<k_mer> hash; //owner of a vertex, DefaultHash unless dna.minimizer_len > 0
+	DnaContext dna; //handed to the parsing threads
+	k_mer ALL_A, ALL_C, ALL_G, ALL_T; //k+1 mers of a repeated base, loops on one vertex
+	VertexTable vertexes;
+	KPlusTable kplus_mers;
+	vector<vector<KPlusTable> > thread_tables; //[thread][destination worker], used when num_threads > 1
+	vector<vector<SuperKmerBuffer> > super_bufs; //[thread][destination worker], used when dna.minimizer_len > 0
 
-	DeBruijn(int k, int freq)
+	DeBruijn(const DeBruijnOptions & opt)
 	{
-		set_mer_length(k);
+		int freq = opt.freq_t;
+		dna.init(opt.k_mer_t, opt.minimizer_t);
+		set_stage_dna(dna);
 		get_loop_kplus();
+		set_ATGC_code();
 		freq_threshold = freq;
+		num_threads = (opt.num_threads > 1) ? opt.num_threads : 1;
+		mem_budget_mb = opt.mem_budget_mb;
+		num_passes = 1;
+		cur_pass = 0;
+		bloom_mb = (freq >= 2) ? opt.bloom_mb : 0; //the pre-filter only drops k+1 mers seen once
+		bloom_pass = false;
+		stream_cache_mb = opt.stream_cache_mb;
+		if(stream_cache_mb > 0)
+			num_threads = 1; //the MPI calls of streaming are made by the parsing thread
+		stream = NULL;
+		stream_cap = 0;
+		dedup = opt.dedup_reads;
+		norm_coverage = opt.normalize_c;
+		norm_mb = opt.normalize_mb;
+		correct_mb = (freq >= 2) ? opt.correct_mb : 0; //with freq_t = 1 every k+1 mer of a read is solid
+		if(opt.correct_mb > 0 && correct_mb == 0 && _my_rank == MASTER_RANK)
+			fprintf(stderr, "correct_mb is ignored with freq_t = %d, read correction needs freq_t >= 2\n", freq);
+		store_writer = NULL;
 	}
 
-	void freeVContainer()
+	void get_loop_kplus()
 	{
-		//note: cannot iterate through the set "vertexes", as deletion will make v->id invalid
-		VertexVector to_del;
-		for (VertexIter p = vertexes.begin(); p != vertexes.end(); p++)
-			to_del.push_back(*p);
-		vertexes.clear();
-		for (int i = 0; i<to_del.size(); i++)
-			delete to_del[i];
+		ALL_A = 0;
+		ALL_C = 0x5555555555555555 >> (62 - 2 * dna.mer_length);
+		ALL_G = 0xAAAAAAAAAAAAAAAA >> (62 - 2 * dna.mer_length);
+		ALL_T = 0xFFFFFFFFFFFFFFFF >> (62 - 2 * dna.mer_length);
 	}
 
-	~DeBruijn()
+	bool is_loop_kplus(k_mer id)
 	{
-		freeVContainer();
+		if(id == ALL_A || id == ALL_C || id == ALL_G || id == ALL_T )
+			return true;
+		return false;
 	}
 
-	void get_loop_kplus()
+	//==============================
+	//multi-pass mode: a pass builds the vertices of its slice only
+	//a k+1 mer is counted in a pass if either of its two vertices is in the slice,
+	//so the vertices of a slice are complete after each pass and can be dumped and freed
+
+	inline bool in_pass(k_mer vid)
 	{
-		ALL_A = 0;
-		ALL_C = 0x5555555555555555 >> (62 - 2 * mer_length);
-		ALL_G = 0xAAAAAAAAAAAAAAAA >> (62 - 2 * mer_length);
-		ALL_T = 0xFFFFFFFFFFFFFFFF >> (62 - 2 * mer_length);
+		return num_passes == 1 || kmer_mix(vid) % num_passes == cur_pass;
 	}
 
-	bool is_loop_kplus(KPlus_mer* kplus)
+	inline bool kplus_in_pass(KPlusRoller & roller)
 	{
-		if(kplus->id == ALL_A || kplus->id == ALL_C || kplus->id == ALL_G || kplus->id == ALL_T )
-			return true;
-		return false;
+		return bloom_pass || num_passes == 1 || in_pass(roller.left_vertex()) || in_pass(roller.right_vertex());
+	}
+
+	//the number of passes that keep "need" bytes of k+1 mer counts per worker within mem_budget_mb, the same on all workers
+	//"held" bytes of the worker stay in memory during the passes (the reads of reads_in_memory(), "solid"), they are taken from the budget
+	int count_passes(long long need, long long held)
+	{
+		if(mem_budget_mb <= 0)
+			return 1;
+		long long budget = ((long long)mem_budget_mb << 20) - all_max_LL(held);
+		if(budget <= 0)
+		{
+			if(_my_rank == MASTER_RANK)
+				fprintf(stderr, "mem_budget_mb = %d is taken up by bloom_mb and the reads kept in memory for dedup_reads/normalize_c/correct_mb!\n", mem_budget_mb);
+			exit(-1);
+		}
+		need = all_max_LL(need);
+		long long passes = (need + budget - 1) / budget;
+		return (passes > 1) ? (int)passes : 1;
 	}
 
-	void split(char * str, vector<char *> & out) //split by 'N'
+	//sets num_passes from mem_budget_mb for "kplus" distinct k+1 mers of the worker,
+	//a k+1 mer is counted in the passes of both of its vertices
+	void set_num_passes(long long kplus, long long held = 0)
 	{
-		char * cur = str;
-		for (int i = 0; str[i] != '\0'; i++)
+		num_passes = count_passes(2 * kplus * KPLUS_MEM_BYTES, held);
+		if(_my_rank == MASTER_RANK && num_passes > 1)
+			cout << "De Bruijn graph built in " << num_passes << " passes" << endl;
+	}
+
+	//the input bytes of reads "splits", which bound their number of distinct k+1 mers
+	long long input_bytes(vector<string> & splits)
+	{
+		long long bytes = 0;
+		hdfsFS fs = getHdfsFS();
+		for(size_t i = 0; i < splits.size(); i++)
 		{
-			if (str[i] == 'N')
+			hdfsFileInfo* info = hdfsGetPathInfo(fs, splits[i].c_str());
+			if(info == NULL)
 			{
-				str[i] = '\0';
-				out.push_back(cur);
-				cur = str + i + 1;
+				fprintf(stderr, "Failed to get info of %s!\n", splits[i].c_str());
+				exit(-1);
 			}
+			long long size = info->mSize;
+			if(splits[i].size() > 3 && splits[i].compare(splits[i].size() - 3, 3, ".gz") == 0)
+				size *= GZIP_RATIO;
+			else if(is_packed_reads(fs, splits[i].c_str()))
+				size *= 4; //4 bases per byte
+			bytes += size;
+			hdfsFreeFileInfo(info, 1);
 		}
-		out.push_back(cur);
+		hdfsDisconnect(fs);
+		return bytes;
 	}
 
 	//==============================
+	//Bloom pre-filter: a first pass over the input marks every k+1 mer in "seen_once",
+	//and in "seen_twice" if all its bits were already set
+	//each owner then merges the filters of all workers for its part: a bit is solid if
+	//any worker saw it twice or at least two workers saw it once
+	//the counting pass only counts k+1 mers whose bits are all solid, so every k+1 mer
+	//that occurs twice is counted exactly, while most singletons never enter the table
+	//each filter has bloom_mb per worker: building "solid" peaks at about 3 * bloom_mb (seen_once, seen_twice and the
+	//receive buffer) plus 2 * bloom_mb / _num_workers, and "solid" then stays through the counting passes
 
-	void add_kplus_mer(KPlus_mer* kplus)
+	inline void bloom_insert(k_mer id, int part)
 	{
-		if(is_loop_kplus(kplus))
-		{
-			delete kplus;
-			return;
-		}
-		KPlusIter itr = kplus_mers.find(kplus);
-		if (itr != kplus_mers.end())
+		u64 h = kmer_mix(id);
+		for(int i = 0; i < KmerBloom::NUM_HASHES; i++)
 		{
-			KPlus_mer * v = *itr;
-			v->count += kplus->count;
-			delete kplus;
+			u64 pos = seen_once.position(part, h, i);
+			if(seen_once.set_bit(pos))
+				seen_twice.set_bit(pos);
 		}
-		else
-			kplus_mers.insert(kplus);
 	}
 
-	void add_kplus_mers(char* line)
+	void build_solid_filter(vector<string> & splits)
 	{
-		vector<char *> reads;
-		split(line, reads);
-		for (int i = 0; i<reads.size(); i++)
+		u64 part_bits = ((u64)bloom_mb << 23) / _num_workers;
+		seen_once.init(part_bits, _num_workers);
+		seen_twice.init(part_bits, _num_workers);
+		bloom_pass = true;
+		load_splits(splits);
+		bloom_pass = false;
+		//------
+		u64 part_words = seen_once.part_words;
+		vector<u64> my_once(part_words, 0), my_twice(part_words, 0);
+		vector<u64> recv(part_words * _num_workers);
+		all_to_all_words(&seen_twice.words[0], part_words, &recv[0]);
+		seen_twice.clear();
+		for(int w = 0; w < _num_workers; w++)
 		{
-			char * read = reads[i];
-			int length = strlen(read);
-			if(length < mer_length + 1)
-				continue;
-			int count = length - mer_length;
-			for(int j=0; j<count; j++)
+			u64* b2 = &recv[w * part_words];
+			for(u64 i = 0; i < part_words; i++)
+				my_twice[i] |= b2[i];
+		}
+		all_to_all_words(&seen_once.words[0], part_words, &recv[0]);
+		seen_once.clear();
+		for(int w = 0; w < _num_workers; w++)
+		{
+			u64* b1 = &recv[w * part_words];
+			for(u64 i = 0; i < part_words; i++)
 			{
-				char * kmer = read + j;
-				KPlus_mer * kplus = new KPlus_mer;
-				kplus->id2canonical(kmer);
-				kplus->count = 1;
-				add_kplus_mer(kplus);
+				my_twice[i] |= my_once[i] & b1[i];
+				my_once[i] |= b1[i];
 			}
 		}
+		vector<u64>().swap(recv);
+		vector<u64>().swap(my_once);
+		//------
+		solid.init(part_bits, _num_workers);
+		all_gather_words(&my_twice[0], part_words, &solid.words[0]);
 	}
 
 	//==============================
 
-	void add_vertex(DNAVertex* vertex)
+	//a k+1 mer of a read that occurs "count" times
+	inline void count_kplus_mer(KPlusTable & table, k_mer id, u32 count = 1)
 	{
-		VertexIter itr = vertexes.find(vertex);
-		if(itr != vertexes.end())
+		if(bloom_mb > 0)
 		{
-			DNAVertex * v = *itr;
-			//------
-			vector<u32> my_count, new_count, merged;
-			int my_pos = 0, new_pos = 0;
-			parse_vints(my_count, v->freqs);
-			parse_vints(new_count, vertex->freqs);
-			//------
-			bool v1_pol[4] = {false,false,true,true};
-			bool v2_pol[4] = {false, true, false, true};
-
-			for(int j = 0; j < 4; j++)
-			{
-				//LL LH HL HH
-				int shift = getShift(v1_pol[j], v2_pol[j]);
-				//------
-				for(int i=0; i<8; i++)
-				{
-					u32 bit = ATGC_bits[i];
-					bool me_exists = (v->bitmap >> shift) & bit;
-					bool new_exists = (vertex->bitmap >> shift) & bit;
-
-					if(me_exists && new_exists)
-					{
-						merged.push_back(my_count[my_pos++] + new_count[new_pos++]);
-					}
-					else if(me_exists)
-					{
-						merged.push_back(my_count[my_pos++]);
-					}
-					else if(new_exists)
-					{
-						v->bitmap |= (bit << shift);
-						merged.push_back(new_count[new_pos++]);
-					}
-					else
-					{}
-				}
-			}
-			//------
-			vector<u8>().swap(v->freqs);
-			for(int i=0; i<merged.size(); i++)
+			if(bloom_pass)
 			{
-				to_vint(merged[i]);
-				append_vint(v->freqs);
+				bloom_add(id, kplus_hash(id), count);
+				return;
 			}
-			delete vertex;
+			if(!solid.contains(kplus_hash(id), id))
+				return;
 		}
-		else
-			vertexes.insert(vertex);
+		add_kplus_mer(table, id, count);
 	}
 
-	void add_vertices(KPlusVector & vec)
+	inline void bloom_add(k_mer id, int part, u32 count)
 	{
-		for (int i = 0; i<vec.size(); i++)
-		{
-			KPlus_mer* kplus = vec[i];
-			if (kplus->count < freq_threshold)
-			{
-				delete kplus;
-				continue; //filter out low-freq k+1 mers
-			}
-			//------
-			DNAVertex *v1 = new DNAVertex;
-			bool v1_pol = v1->vid2canonical(kplus->get_left_kmer());
-			DNAVertex *v2 = new DNAVertex;
-			bool v2_pol = v2->vid2canonical(kplus->get_right_kmer());
-			int shift = getShift(v1_pol, v2_pol);
-			//------
-			to_vint(kplus->count);
-			v1->set_edgeBit(kplus->get_rightmost(), false, shift);
-			append_vint(v1->freqs);
-			v2->set_edgeBit(kplus->get_leftmost(), true, shift);
-			append_vint(v2->freqs);
-			//------
-			add_vertex(v1);
-			add_vertex(v2);
-			delete kplus;
-		}
+		if(is_loop_kplus(id))
+			return;
+		bloom_insert(id, part);
+		if(count > 1)
+			bloom_insert(id, part); //marks it in "seen_twice"
 	}
 
-	void reduce_kplus_mers()
+	void add_kplus_mer(KPlusTable & table, k_mer id, u32 count)
 	{
-		vector<KPlusVector> _loaded_parts(_num_workers);
-		for(KPlusIter p = kplus_mers.begin(); p != kplus_mers.end(); p++)
+		if(is_loop_kplus(id))
+			return;
+		table.get(id).count += count; //a new entry starts from count = 0
+	}
+
+	void add_kplus_mer(k_mer id, u32 count)
+	{
+		add_kplus_mer(kplus_mers, id, count);
+	}
+
+	void add_kplus_mers(char* line)
+	{
+		parse_reads(line, line + strlen(line), 1, NULL, (dna.minimizer_len > 0) ? &super_bufs[0] : NULL);
+	}
+
+	//the k+1 mers of the reads in [p, end), separated by '\n', each occurring "count" times:
+	//cut into "bufs" in minimizer mode, otherwise counted into "tables" (a parser thread) or the table of the main thread if NULL
+	void parse_reads(const char* p, const char* end, u32 count, vector<KPlusTable>* tables, vector<SuperKmerBuffer>* bufs)
+	{
+		if(dna.minimizer_len > 0)
 		{
-			KPlus_mer* kplus = *p;
-			_loaded_parts[hash(kplus->id)].push_back(kplus);
+			cut_super_kmers(p, end, *bufs, count);
+			return;
 		}
-		//------
-		kplus_mers.clear();
-		KPlusContainer().swap(kplus_mers);
-		//------
-		delete_after_all_to_all(_loaded_parts);
-		for(int i = 0; i < _num_workers; i++)
+		KPlusRoller roller(dna); //'\n' is not ATGC, so the roller restarts at each read
+		for(; p != end; p++)
 		{
-			KPlusVector & vec = _loaded_parts[i];
-			for (int j = 0; j < vec.size(); j++)
-				add_kplus_mer(vec[j]);
+			if(!roller.push(*p) || !kplus_in_pass(roller))
+				continue;
+			k_mer id = roller.canonical();
+			if(tables != NULL)
+				count_kplus_mer((*tables)[kplus_hash(id)], id, count);
+			else if(stream != NULL)
+				stream_kplus_mer(id, count);
+			else
+				count_kplus_mer(kplus_mers, id, count);
 		}
-		vector<KPlusVector>().swap(_loaded_parts);
-		//------
-		KPlusVector kplus_vec;
-		for (KPlusIter p = kplus_mers.begin(); p != kplus_mers.end(); p++)
-			kplus_vec.push_back(*p);
-		kplus_mers.clear();
-		KPlusContainer().swap(kplus_mers);
-		//------
-		add_vertices(kplus_vec);
-	};
+	}
 
-	//==================================
-	void sync_graph()
+	//parser thread: counts the k+1 mers of each block into "tables", one table per destination worker
+	void parse_blocks(ReadBlockQueue & queue, vector<KPlusTable> & tables)
 	{
-		vector<VertexVector> _loaded_parts(_num_workers);
-		for (VertexIter p = vertexes.begin(); p != vertexes.end(); p++)
-		{
-			DNAVertex* v = *p;
-			_loaded_parts[hash(v->id)].push_back(v);
-		}
-		vertexes.clear();
-		VertexContainer().swap(vertexes);
-		delete_after_all_to_all(_loaded_parts);
-		for (int i = 0; i < _num_workers; i++)
+		ReadBlock* block;
+		while((block = queue.pop()) != NULL)
 		{
-			VertexVector & vec = _loaded_parts[i];
-			for(int j = 0; j < vec.size(); j++)
-				add_vertex(vec[j]);
+			if(block->is_packed)
+				parse_packed_block(block->packed, &tables, NULL);
+			else
+				parse_reads(block->text.c_str(), block->text.c_str() + block->text.size(), 1, &tables, NULL);
+			delete block;
 		}
-		_loaded_parts.clear();
-	};
+	}
 
-	void load_graph(const char* inpath)
+	//parser thread of minimizer mode: cuts each block into super k+1 mers
+	void parse_blocks_super(ReadBlockQueue & queue, vector<SuperKmerBuffer> & bufs)
 	{
-		hdfsFS fs = getHdfsFS();
-		hdfsFile in = getRHandle(inpath, fs);
-		LineReader reader(fs, in);
-		while (true)
+		ReadBlock* block;
+		while((block = queue.pop()) != NULL)
 		{
-			reader.readLine();
-			if (!reader.eof())
-				add_kplus_mers(reader.getLine());
+			if(block->is_packed)
+				parse_packed_block(block->packed, NULL, &bufs);
 			else
-				break;
+				parse_reads(block->text.c_str(), block->text.c_str() + block->text.size(), 1, NULL, &bufs);
+			delete block;
 		}
-		hdfsCloseFile(fs, in);
-		hdfsDisconnect(fs);
-		//cout<<"Worker "<<_my_rank<<": \""<<inpath<<"\" loaded"<<endl;//DEBUG !!!!!!!!!!
 	}
 
-	//==============================
-	void dump_partition(const char* outpath)
+	//merges the tables of all threads for destination workers "first", "first + step", ...
+	void merge_thread_tables(vector<KPlusVector> & parts, int first, int step)
 	{
-		hdfsFS fs = getHdfsFS();
-		BufferedWriter* writer = new BufferedWriter(outpath, fs, _my_rank);
-		char buf[100];
-		for (VertexIter it = vertexes.begin(); it != vertexes.end(); it++)
+		for(int i = first; i < _num_workers; i += step)
 		{
-			writer->check();
-			//writer->write((*it)->toString().c_str());
-			// Adding....
-			DNAVertex * v = (*it);
-			vector<u8> & vec = v->freqs;
-			sprintf(buf, "%llu\t%u %d", v->id, v->bitmap, vec.size());
-			writer->write(buf);
-			for(int i=0; i<vec.size(); i++)
+			KPlusTable & merged = thread_tables[0][i];
+			for(int t = 1; t < num_threads; t++)
 			{
-				sprintf(buf, " %hhu", vec[i]);
-				writer->write(buf);
+				KPlusTable & table = thread_tables[t][i];
+				for(size_t j = 0; j < table.capacity(); j++)
+				{
+					if(table.used(j))
+						merged.get(table.slots[j].id).count += table.slots[j].count;
+				}
+				table.clear();
 			}
-			//.................
-			writer->write("\n");
+			KPlusVector & vec = parts[i];
+			vec.reserve(merged.size());
+			for(size_t j = 0; j < merged.capacity(); j++)
+			{
+				if(merged.used(j))
+					vec.push_back(merged.slots[j]);
+			}
+			merged.clear();
+		}
+	}
+
+	//==============================
+	//minimizer mode: instead of counting locally, the k+1 mers of the reads are shipped as super k+1 mers,
+	//maximal runs of consecutive k+1 mers with the same owner, 2 bits per base
+	//a run of n k+1 mers costs n + k bases, instead of n (id, count) pairs,
+	//and the owner counts them, so a k+1 mer is still counted by exactly one worker
+
+	void cut_super_kmers(const char* p, const char* end, vector<SuperKmerBuffer> & bufs, u32 count)
+	{
+		KPlusRoller roller(dna); //'\n' is not ATGC, so the rollers restart at each read
+		MinimizerRoller mroller(dna);
+		const char* run_start = NULL;
+		const char* run_end = NULL; //one past the last base of the current run
+		int run_owner = -1;
+		for(; p != end; p++)
+		{
+			mroller.push(*p);
+			if(!roller.push(*p) || !kplus_in_pass(roller))
+				continue;
+			int owner = minimizer_owner(mroller.minimum());
+			if(bloom_pass)
+			{
+				bloom_add(roller.canonical(), owner, count);
+				continue;
+			}
+			if(run_end == p && owner == run_owner)
+				run_end = p + 1; //extends the run by one k+1 mer
+			else
+			{
+				if(run_end != NULL)
+					emit_super_kmer(run_start, run_end, bufs, run_owner, count);
+				run_start = p - dna.mer_length;
+				run_end = p + 1;
+				run_owner = owner;
+			}
+		}
+		if(run_end != NULL)
+			emit_super_kmer(run_start, run_end, bufs, run_owner, count);
+	}
+
+	inline void emit_super_kmer(const char* start, const char* end, vector<SuperKmerBuffer> & bufs, int owner, u32 count)
+	{
+		pack_super_kmer(start, end, bufs[owner], count);
+		if(stream != NULL && bufs[owner].size() >= stream_cap)
+			flush_super_kmers(owner);
+	}
+
+	inline void emit_super_kmer(const u64* words, u64 pos, u64 n, vector<SuperKmerBuffer> & bufs, int owner)
+	{
+		pack_super_kmer_bits(words, pos, n, bufs[owner]);
+		if(stream != NULL && bufs[owner].size() >= stream_cap)
+			flush_super_kmers(owner);
+	}
+
+	//counts the k+1 mers of super k+1 mers number "first", "first + step", ... of "buf"
+	void count_super_kmers(SuperKmerBuffer & buf, KPlusTable & table, int first, int step)
+	{
+		size_t pos = 0;
+		for(long long i = 0; pos < buf.size(); i++)
+		{
+			u64 n = buf[pos] & 0xFFFFFFFFull;
+			u32 count = buf[pos++] >> 32;
+			u64* words = &buf[pos];
+			pos += (n + 31) >> 5;
+			if(i % step != first)
+				continue;
+			KPlusRoller roller(dna);
+			for(u64 j = 0; j < n; j++)
+			{
+				if(roller.push_code((words[j >> 5] >> (62 - 2 * (j & 31))) & 3ull))
+				{
+					k_mer id = roller.canonical();
+					if(bloom_mb > 0 && !solid.contains(_my_rank, id))
+						continue;
+					add_kplus_mer(table, id, count);
+				}
+			}
+		}
+	}
+
+	void count_super_parts(vector<SuperKmerBuffer> & parts, KPlusTable & table, int first, int step)
+	{
+		for(int i = 0; i < _num_workers; i++)
+			count_super_kmers(parts[i], table, first, step);
+	}
+
+	void reduce_super_kmers()
+	{
+		vector<SuperKmerBuffer> parts(_num_workers);
+		for(int t = 0; t < super_bufs.size(); t++)
+		{
+			for(int i = 0; i < _num_workers; i++)
+			{
+				SuperKmerBuffer & buf = super_bufs[t][i];
+				parts[i].insert(parts[i].end(), buf.begin(), buf.end());
+				SuperKmerBuffer().swap(buf);
+			}
+		}
+		vector<vector<SuperKmerBuffer> >().swap(super_bufs);
+		//------
+		all_to_all(parts);
+		if (num_threads > 1)
+		{
+			vector<KPlusTable> tables(num_threads);
+			vector<thread> counters;
+			for(int t = 0; t < num_threads; t++)
+				counters.push_back(thread(&DeBruijn::count_super_parts, this, ref(parts), ref(tables[t]), t, num_threads));
+			for(int t = 0; t < num_threads; t++)
+				counters[t].join();
+			vector<SuperKmerBuffer>().swap(parts);
+			kplus_mers.swap(tables[0]);
+			for(int t = 1; t < num_threads; t++)
+			{
+				KPlusTable & table = tables[t];
+				for(size_t j = 0; j < table.capacity(); j++)
+				{
+					if(table.used(j))
+						kplus_mers.get(table.slots[j].id).count += table.slots[j].count;
+				}
+				table.clear();
+			}
+		}
+		else
+		{
+			kplus_mers.clear();
+			count_super_parts(parts, kplus_mers, 0, 1);
+		}
+	}
+
+	//==============================
+	//packed reads (see packed_reads.h): the rollers are fed 2-bit codes straight from the words,
+	//and each read is parsed as the segments between its 'N' runs
+
+	//k+1 mers of the n bases from base "first", into "tables" (a parser thread) or the table of the main thread
+	void count_packed_bases(const u64* words, u64 first, u64 n, vector<KPlusTable>* tables)
+	{
+		KPlusRoller roller(dna);
+		PackedCursor cursor(words, first);
+		for(u64 i = 0; i < n; i++)
+		{
+			if(!roller.push_code(cursor.next()) || !kplus_in_pass(roller))
+				continue;
+			k_mer id = roller.canonical();
+			if(tables != NULL)
+				count_kplus_mer((*tables)[kplus_hash(id)], id);
+			else if(stream != NULL)
+				stream_kplus_mer(id);
+			else
+				count_kplus_mer(kplus_mers, id);
+		}
+	}
+
+	//same as cut_super_kmers(), for the n bases from base "first"
+	void cut_packed_super_kmers(const u64* words, u64 first, u64 n, vector<SuperKmerBuffer> & bufs)
+	{
+		KPlusRoller roller(dna);
+		MinimizerRoller mroller(dna);
+		PackedCursor cursor(words, first);
+		u64 run_start = 0;
+		u64 run_end = 0; //one past the last base of the current run, 0 = no run
+		int run_owner = -1;
+		for(u64 i = 0; i < n; i++)
+		{
+			k_mer code = cursor.next();
+			mroller.push_code(code);
+			if(!roller.push_code(code) || !kplus_in_pass(roller))
+				continue;
+			int owner = minimizer_owner(mroller.minimum());
+			if(bloom_pass)
+			{
+				bloom_add(roller.canonical(), owner, 1);
+				continue;
+			}
+			if(run_end == i && owner == run_owner)
+				run_end = i + 1;
+			else
+			{
+				if(run_end != 0)
+					emit_super_kmer(words, first + run_start, run_end - run_start, bufs, run_owner);
+				run_start = i - dna.mer_length;
+				run_end = i + 1;
+				run_owner = owner;
+			}
+		}
+		if(run_end != 0)
+			emit_super_kmer(words, first + run_start, run_end - run_start, bufs, run_owner);
+	}
+
+	//"bufs" is used in minimizer mode, "tables" otherwise (NULL on the main thread)
+	void parse_packed_block(PackedBlock & block, vector<KPlusTable>* tables, vector<SuperKmerBuffer>* bufs)
+	{
+		u64 first = 0; //first base of the current read
+		u32* run = block.runs;
+		for(u32 r = 0; r < block.header.num_reads; r++)
+		{
+			u32 len = block.lengths[r];
+			u32 start = 0; //first base of the current segment
+			for(u32 j = 0; j <= block.run_counts[r]; j++)
+			{
+				u32 end = (j < block.run_counts[r]) ? run[0] : len;
+				if(end - start > (u32)dna.mer_length)
+				{
+					if(dna.minimizer_len > 0)
+						cut_packed_super_kmers(block.words, first + start, end - start, *bufs);
+					else
+						count_packed_bases(block.words, first + start, end - start, tables);
+				}
+				if(j < block.run_counts[r])
+				{
+					start = run[0] + run[1];
+					run += 2;
+				}
+			}
+			first += len;
+			if(stream != NULL && (r + 1) % STREAM_POLL_READS == 0)
+				poll_stream();
+		}
+	}
+
+	//==============================
+	//read deduplication: every read is sent to the owner of its canonical form, the smaller of the read
+	//and its reverse complement, which collapses the copies of a read into one read and its number of occurrences
+	//the counting passes then parse the distinct reads only, adding the occurrences to the counts,
+	//which gives the same graph, as a read and its reverse complement have the same canonical k+1 mers
+
+	static u64 read_hash(const char* p, int len) //FNV-1a, the same on all workers
+	{
+		u64 h = 14695981039346656037ull;
+		for(int i = 0; i < len; i++)
+		{
+			h ^= (u8)p[i];
+			h *= 1099511628211ull;
+		}
+		return h;
+	}
+
+	void dedup_read(const char* seq, int len, string & rc, vector<string> & parts)
+	{
+		if(len <= 0) return; //an empty read has no k+1 mers
+		rc.resize(len);
+		for(int i = 0; i < len; i++)
+		{
+			char c = seq[len - 1 - i];
+			u8 code = ATGC_code[(u8)c];
+			rc[i] = (code == NOT_ATGC) ? c : "ACGT"[code ^ 3];
+		}
+		const char* canonical = (memcmp(rc.c_str(), seq, (size_t)len) < 0) ? rc.c_str() : seq;
+		string & part = parts[kmer_mix(read_hash(canonical, len)) % _num_workers];
+		part.append(canonical, len);
+		part.push_back('\n');
+	}
+
+	//==============================
+	//digital normalization: a read is kept only if the median count of its k+1 mers is below "norm_coverage",
+	//and the k+1 mers of a kept read are then added to the count-min sketch, so coverage beyond it is dropped
+	//every worker holds a replica of the sketch, and the workers add up their increments every NORM_BATCH_READS reads
+	//(between two syncs a worker does not see the reads kept by the others, so a little more than the target is kept)
+
+	bool normalize_read(const char* seq, int len)
+	{
+		norm_ids.clear();
+		norm_ests.clear();
+		KPlusRoller roller(dna);
+		for(int i = 0; i < len; i++)
+		{
+			if(roller.push(seq[i]))
+			{
+				k_mer id = roller.canonical();
+				norm_ids.push_back(id);
+				norm_ests.push_back(norm_sketch.estimate(id));
+			}
+		}
+		if(norm_ids.empty())
+			return false; //no k+1 mer to count
+		nth_element(norm_ests.begin(), norm_ests.begin() + norm_ests.size() / 2, norm_ests.end());
+		if(norm_ests[norm_ests.size() / 2] >= norm_coverage)
+			return false;
+		for(size_t i = 0; i < norm_ids.size(); i++)
+			norm_sketch.add(norm_ids[i]);
+		return true;
+	}
+
+	//returns true once all workers have read all their reads
+	bool norm_sync(bool finished)
+	{
+		norm_sketch.sync();
+		return all_sum(finished ? 1 : 0) == _num_workers;
+	}
+
+	//==============================
+	//read error correction: the k+1 mers of the reads in memory are counted, and each owner marks
+	//its solid k+1 mers (count >= freq_threshold) in its part of "trusted", which all workers then gather
+	//under mem_budget_mb they are counted in slices, a pass counts those of its slice (in_pass() of the k+1 mer)
+	//a read is scanned for runs of k+1 mers that are not trusted, a single wrong base makes such a run start
+	//right after a trusted k+1 mer (or end right before one, at the head of the read), so the base entering
+	//the run is tried as the three other bases, and fixed if exactly one makes all k+1 mers around it trusted
+
+	inline bool is_trusted(k_mer id)
+	{
+		return is_loop_kplus(id) || trusted.contains(kplus_hash(id), id); //loops are never counted
+	}
+
+	//the k+1 mer at "p" is trusted, or has a non-ATGC base, which cannot be judged
+	bool trusted_at(const char* p)
+	{
+		KPlusRoller roller(dna);
+		bool valid = false;
+		for(int i = 0; i <= dna.mer_length; i++)
+			valid = roller.push(p[i]);
+		return !valid || is_trusted(roller.canonical());
+	}
+
+	//tries the other bases at "pos", returns true if the base is fixed
+	bool fix_base(char* seq, int len, int pos)
+	{
+		static const char bases[4] = { 'A', 'C', 'G', 'T' };
+		char orig = seq[pos];
+		if(ATGC_code[(u8)orig] == NOT_ATGC)
+			return false;
+		int first = (pos > dna.mer_length) ? pos - dna.mer_length : 0;
+		int last = (pos < len - dna.mer_length - 1) ? pos : len - dna.mer_length - 1; //starts of the k+1 mers around "pos"
+		int found = 0;
+		char fixed = orig;
+		for(int b = 0; b < 4; b++)
+		{
+			if(bases[b] == orig)
+				continue;
+			seq[pos] = bases[b];
+			int s = first;
+			while(s <= last && trusted_at(seq + s))
+				s++;
+			if(s > last)
+			{
+				found++;
+				fixed = bases[b];
+			}
+		}
+		seq[pos] = (found == 1) ? fixed : orig;
+		return found == 1;
+	}
+
+	//returns the number of bases fixed in the read
+	int correct_read(char* seq, int len, vector<bool> & good)
+	{
+		int n = len - dna.mer_length; //k+1 mers in the read
+		if(n <= 0)
+			return 0;
+		good.assign(n, true);
+		KPlusRoller roller(dna);
+		for(int i = 0; i < len; i++)
+		{
+			if(roller.push(seq[i]))
+				good[i - dna.mer_length] = is_trusted(roller.canonical());
+		}
+		int num_fixed = 0;
+		for(int s = 0; s < n; s++)
+		{
+			if(good[s])
+				continue;
+			int pos = s + dna.mer_length; //the base entering the run
+			if(s == 0)
+			{
+				int t = 1;
+				while(t < n && !good[t])
+					t++;
+				if(t == n)
+					return num_fixed; //no trusted k+1 mer to start from
+				pos = t - 1; //the base leaving the run
+			}
+			if(fix_base(seq, len, pos))
+			{
+				num_fixed++;
+				int last = (pos < n - 1) ? pos : n - 1;
+				for(int j = (pos > dna.mer_length) ? pos - dna.mer_length : 0; j <= last; j++)
+					good[j] = true;
+			}
+			while(s < n && !good[s])
+				s++;
+		}
+		return num_fixed;
+	}
+
+	//counts the k+1 mers of the current pass of reads number "first", "first + step", ... into thread_tables[first]
+	void count_read_part(int first, int step)
+	{
+		vector<KPlusTable> & tables = thread_tables[first];
+		const char* p = unique_reads.c_str();
+		const char* end = p + unique_reads.size();
+		for(size_t i = 0; p < end; i++)
+		{
+			const char* eol = (const char*)memchr(p, '\n', end - p);
+			if(i % step == first)
+			{
+				KPlusRoller roller(dna);
+				for(const char* q = p; q != eol; q++)
+				{
+					if(roller.push(*q))
+					{
+						k_mer id = roller.canonical();
+						if(in_pass(id))
+							add_kplus_mer(tables[kplus_hash(id)], id, read_counts[i]);
+					}
+				}
+			}
+			p = eol + 1;
+		}
+	}
+
+	//corrects reads number "first", "first + step", ...
+	void correct_read_part(int first, int step, vector<long long> & fixed_reads, vector<long long> & fixed_bases)
+	{
+		vector<bool> good;
+		char* p = &unique_reads[0];
+		char* end = p + unique_reads.size();
+		for(size_t i = 0; p < end; i++)
+		{
+			char* eol = (char*)memchr(p, '\n', end - p);
+			if(i % step == first)
+			{
+				int n = correct_read(p, eol - p, good);
+				if(n > 0)
+				{
+					fixed_reads[first]++;
+					fixed_bases[first] += n;
+				}
+			}
+			p = eol + 1;
+		}
+	}
+
+	//counts the k+1 mers of the current pass, and marks the solid ones of this worker in "mine"
+	void count_trusted_pass(KmerBloom & mine)
+	{
+		thread_tables.assign(num_threads, vector<KPlusTable>(_num_workers));
+		vector<KPlusVector> parts(_num_workers);
+		if(num_threads > 1)
+		{
+			vector<thread> workers;
+			for(int t = 0; t < num_threads; t++)
+				workers.push_back(thread(&DeBruijn::count_read_part, this, t, num_threads));
+			for(int t = 0; t < num_threads; t++)
+				workers[t].join();
+			workers.clear();
+			for(int t = 0; t < num_threads; t++)
+				workers.push_back(thread(&DeBruijn::merge_thread_tables, this, ref(parts), t, num_threads));
+			for(int t = 0; t < num_threads; t++)
+				workers[t].join();
+		}
+		else
+		{
+			count_read_part(0, 1);
+			merge_thread_tables(parts, 0, 1);
+		}
+		vector<vector<KPlusTable> >().swap(thread_tables);
+		all_to_all(parts);
+		for(int i = 0; i < _num_workers; i++)
+		{
+			KPlusVector & vec = parts[i];
+			for(size_t j = 0; j < vec.size(); j++)
+				add_kplus_mer(vec[j].id, vec[j].count);
+			KPlusVector().swap(vec);
+		}
+		//------
+		for(size_t i = 0; i < kplus_mers.capacity(); i++)
+		{
+			if(!kplus_mers.used(i) || kplus_mers.slots[i].count < freq_threshold)
+				continue;
+			u64 h = kmer_mix(kplus_mers.slots[i].id);
+			for(int j = 0; j < KmerBloom::NUM_HASHES; j++)
+				mine.set_bit(mine.position(0, h, j));
+		}
+		kplus_mers.clear();
+	}
+
+	void correct_reads()
+	{
+		//count the k+1 mers and mark the solid ones of this worker, then gather the parts of all workers
+		//a k+1 mer is counted in the pass of its own slice only, so the reads bound the counts of a pass
+		u64 part_bits = ((u64)correct_mb << 23) / _num_workers;
+		KmerBloom mine;
+		mine.init(part_bits, 1);
+		long long held = unique_reads.capacity() + read_counts.capacity() * sizeof(u32) + mine.part_words * sizeof(u64);
+		num_passes = count_passes(unique_reads.size() * KPLUS_MEM_BYTES, held);
+		if(_my_rank == MASTER_RANK && num_passes > 1)
+			cout << "k+1 mers for read correction counted in " << num_passes << " passes" << endl;
+		for(cur_pass = 0; cur_pass < num_passes; cur_pass++)
+			count_trusted_pass(mine);
+		num_passes = 1; //the graph passes are set by set_num_passes()
+		cur_pass = 0;
+		trusted.init(part_bits, _num_workers);
+		all_gather_words(&mine.words[0], mine.part_words, &trusted.words[0]);
+		mine.clear();
+		//------
+		vector<long long> fixed_reads(num_threads, 0), fixed_bases(num_threads, 0);
+		if(num_threads > 1)
+		{
+			vector<thread> workers;
+			for(int t = 0; t < num_threads; t++)
+				workers.push_back(thread(&DeBruijn::correct_read_part, this, t, num_threads, ref(fixed_reads), ref(fixed_bases)));
+			for(int t = 0; t < num_threads; t++)
+				workers[t].join();
+		}
+		else
+			correct_read_part(0, 1, fixed_reads, fixed_bases);
+		trusted.clear();
+		long long reads = 0, bases = 0;
+		for(int t = 0; t < num_threads; t++)
+		{
+			reads += fixed_reads[t];
+			bases += fixed_bases[t];
+		}
+		reads = master_sum_LL(reads);
+		bases = master_sum_LL(bases);
+		if(_my_rank == MASTER_RANK)
+			cout << bases << " bases corrected in " << reads << " reads" << endl;
+	}
+
+	//==============================
+	//dedup, normalization and correction read the input once and keep the reads to count in memory,
+	//then the counting passes parse them instead of the splits (see load_unique_reads())
+
+	inline bool reads_in_memory()
+	{
+		return dedup || norm_coverage > 0 || correct_mb > 0;
+	}
+
+	void take_read(const char* seq, int len)
+	{
+		num_reads++;
+		if(norm_coverage > 0)
+		{
+			bool kept = normalize_read(seq, len);
+			if(++norm_batch == NORM_BATCH_READS)
+			{
+				norm_sync(false);
+				norm_batch = 0;
+			}
+			if(!kept)
+				return;
+		}
+		num_kept++;
+		if(dedup && correct_mb == 0) //otherwise the reads are deduplicated once corrected
+			dedup_read(seq, len, rc_buf, dedup_parts);
+		else
+		{
+			unique_reads.append(seq, len);
+			unique_reads.push_back('\n');
+			read_counts.push_back(1);
+		}
+	}
+
+	void prepare_reads(vector<string> & splits)
+	{
+		unique_reads.clear();
+		read_counts.clear();
+		num_reads = num_kept = 0;
+		if(dedup)
+			dedup_parts.assign(_num_workers, string());
+		if(norm_coverage > 0)
+		{
+			norm_sketch.init(((u64)norm_mb << 20) / (2 * sizeof(u32))); //"counts" and "delta"
+			norm_batch = 0;
+		}
+		hdfsFS fs = getHdfsFS();
+		for(size_t i = 0; i < splits.size(); i++)
+		{
+			const char* path = splits[i].c_str();
+			bool packed = is_packed_reads(fs, path);
+			hdfsFile in = getRHandle(path, fs);
+			if(packed)
+			{
+				PackedReader reader(fs, in, path);
+				PackedBlock block;
+				string text;
+				while(reader.next(block))
+				{
+					text.clear();
+					unpack_block(block, text);
+					const char* p = text.c_str();
+					const char* end = p + text.size();
+					while(p < end)
+					{
+						const char* eol = (const char*)memchr(p, '\n', end - p);
+						take_read(p, eol - p);
+						p = eol + 1;
+					}
+				}
+			}
+			else
+			{
+				SeqReader reader(fs, in);
+				while(reader.next())
+					take_read(reader.seq, reader.length);
+			}
+			hdfsCloseFile(fs, in);
+		}
+		hdfsDisconnect(fs);
+		if(norm_coverage > 0)
+		{
+			while(!norm_sync(true)); //the other workers may still be reading
+			norm_sketch.clear();
+			long long total = master_sum_LL(num_reads);
+			long long kept = master_sum_LL(num_kept);
+			if(_my_rank == MASTER_RANK)
+				cout << kept << " reads kept by normalization out of " << total << endl;
+		}
+		if(correct_mb > 0)
+			correct_reads();
+		if(dedup)
+		{
+			if(correct_mb > 0)
+			{
+				const char* p = unique_reads.c_str();
+				const char* end = p + unique_reads.size();
+				while(p < end)
+				{
+					const char* eol = (const char*)memchr(p, '\n', end - p);
+					dedup_read(p, eol - p, rc_buf, dedup_parts);
+					p = eol + 1;
+				}
+				string().swap(unique_reads);
+				vector<u32>().swap(read_counts);
+			}
+			collapse_reads();
+		}
+	}
+
+	void collapse_reads()
+	{
+		all_to_all(dedup_parts);
+		unordered_map<string, u32> counts;
+		string read;
+		for(int i = 0; i < _num_workers; i++)
+		{
+			const char* p = dedup_parts[i].c_str();
+			const char* end = p + dedup_parts[i].size();
+			while(p < end)
+			{
+				const char* eol = (const char*)memchr(p, '\n', end - p);
+				read.assign(p, eol - p);
+				counts[read]++;
+				p = eol + 1;
+			}
+			string().swap(dedup_parts[i]);
+		}
+		vector<string>().swap(dedup_parts);
+		read_counts.reserve(counts.size());
+		for(unordered_map<string, u32>::iterator it = counts.begin(); it != counts.end(); it++)
+		{
+			unique_reads.append(it->first);
+			unique_reads.push_back('\n');
+			read_counts.push_back(it->second);
+		}
+		//------
+		long long total = master_sum_LL(num_kept);
+		long long distinct = master_sum_LL(read_counts.size());
+		if(_my_rank == MASTER_RANK)
+			cout << distinct << " distinct reads out of " << total << endl;
+	}
+
+	//parses the distinct reads number "first", "first + step", ..., see parse_reads()
+	void parse_unique_reads(int first, int step, vector<KPlusTable>* tables, vector<SuperKmerBuffer>* bufs)
+	{
+		const char* p = unique_reads.c_str();
+		const char* end = p + unique_reads.size();
+		for(size_t i = 0; p < end; i++)
+		{
+			const char* eol = (const char*)memchr(p, '\n', end - p);
+			if(i % step == first)
+				parse_reads(p, eol, read_counts[i], tables, bufs);
+			p = eol + 1;
+			if(stream != NULL && (i + 1) % STREAM_POLL_READS == 0)
+				poll_stream();
+		}
+	}
+
+	void load_unique_reads()
+	{
+		if(num_threads == 1)
+		{
+			parse_unique_reads(0, 1, NULL, (dna.minimizer_len > 0) ? &super_bufs[0] : NULL);
+			return;
+		}
+		if(dna.minimizer_len == 0)
+			thread_tables.assign(num_threads, vector<KPlusTable>(_num_workers));
+		vector<thread> parsers;
+		for(int t = 0; t < num_threads; t++)
+		{
+			if(dna.minimizer_len > 0)
+				parsers.push_back(thread(&DeBruijn::parse_unique_reads, this, t, num_threads, (vector<KPlusTable>*)NULL, &super_bufs[t]));
+			else
+				parsers.push_back(thread(&DeBruijn::parse_unique_reads, this, t, num_threads, &thread_tables[t], (vector<SuperKmerBuffer>*)NULL));
+		}
+		for(int t = 0; t < num_threads; t++)
+			parsers[t].join();
+	}
+
+	//==============================
+	//streaming mode: instead of shuffling once the whole input is parsed, the k+1 mers sent to a worker
+	//are pre-combined in a fixed-size cache, and a full cache is sent while parsing goes on
+	//the batches that arrive are merged into "kplus_mers" whenever the parser polls,
+	//so a worker holds its caches and its own k+1 mers, and the network works during the parsing
+	//in minimizer mode the caches are the super k+1 mer buffers, which are counted on arrival
+
+	void begin_stream()
+	{
+		stream = new StreamChannel(STREAM_MAX_PENDING * _num_workers);
+		long long bytes = ((long long)stream_cache_mb << 20) / _num_workers;
+		if(dna.minimizer_len > 0)
+		{
+			stream_cap = bytes / sizeof(u64);
+			return;
+		}
+		size_t slots = 16;
+		while((slots << 1) * sizeof(KPlus_mer) <= bytes)
+			slots <<= 1;
+		stream_cap = slots * 7 / 10 - 1; //below the load factor of KmerTable, a cache never grows
+		stream_cache.assign(_num_workers, KPlusTable(slots));
+	}
+
+	inline void stream_kplus_mer(k_mer id, u32 count = 1)
+	{
+		int dst = kplus_hash(id);
+		if(dst == _my_rank)
+		{
+			count_kplus_mer(kplus_mers, id, count);
+			return;
+		}
+		KPlusTable & cache = stream_cache[dst];
+		count_kplus_mer(cache, id, count);
+		if(cache.size() >= stream_cap)
+			flush_cache(dst);
+	}
+
+	void send_batch(ibinstream* m, int dst)
+	{
+		while(stream->full())
+			poll_stream();
+		stream->send(m, dst);
+	}
+
+	void flush_cache(int dst)
+	{
+		KPlusTable & cache = stream_cache[dst];
+		ibinstream* m = new ibinstream;
+		*m << cache.size();
+		for(size_t j = 0; j < cache.capacity(); j++)
+		{
+			if(cache.used(j))
+				*m << cache.slots[j];
+		}
+		cache.reset();
+		send_batch(m, dst);
+	}
+
+	void flush_super_kmers(int dst)
+	{
+		SuperKmerBuffer & buf = super_bufs[0][dst];
+		if(dst == _my_rank)
+			count_super_kmers(buf, kplus_mers, 0, 1);
+		else
+		{
+			ibinstream* m = new ibinstream;
+			*m << buf;
+			send_batch(m, dst);
+		}
+		buf.clear();
+	}
+
+	void poll_stream()
+	{
+		obinstream* um;
+		while((um = stream->try_recv()) != NULL)
+		{
+			if(dna.minimizer_len > 0)
+			{
+				SuperKmerBuffer buf;
+				*um >> buf;
+				count_super_kmers(buf, kplus_mers, 0, 1);
+			}
+			else
+			{
+				size_t n;
+				*um >> n;
+				KPlus_mer kplus;
+				for(size_t i = 0; i < n; i++)
+				{
+					*um >> kplus;
+					add_kplus_mer(kplus.id, kplus.count);
+				}
+			}
+			delete um;
+		}
+	}
+
+	//flushes all caches, then merges batches until every worker has ended its stream
+	void finish_stream()
+	{
+		for(int i = 0; i < _num_workers; i++)
+		{
+			if(dna.minimizer_len > 0)
+			{
+				if(!super_bufs[0][i].empty())
+					flush_super_kmers(i);
+			}
+			else if(i != _my_rank && stream_cache[i].size() > 0)
+				flush_cache(i);
+		}
+		stream->end_stream();
+		while(!stream->done())
+			poll_stream();
+		delete stream;
+		stream = NULL;
+		vector<KPlusTable>().swap(stream_cache);
+		vector<vector<SuperKmerBuffer> >().swap(super_bufs);
+	}
+
+	//==============================
+	//count store: the counts of the k+1 mers owned by a worker are written before any threshold,
+	//sorted by id in groups of STORE_GROUP_SIZE, each id as a vint of its delta to the previous one,
+	//so DeBruijn_FromStore() can build the graph for any freq_t >= min_count without reading the reads again
+	//in multi-pass mode a k+1 mer is written in the pass of its left vertex only, so it is written once
+
+	static bool kplus_less(const KPlus_mer & a, const KPlus_mer & b)
+	{
+		return a.id < b.id;
+	}
+
+	void store_kplus_mers()
+	{
+		KPlusVector vec;
+		for (size_t i = 0; i < kplus_mers.capacity(); i++)
+		{
+			if (!kplus_mers.used(i))
+				continue;
+			KPlus_mer & kplus = kplus_mers.slots[i];
+			k_mer id1;
+			vid2canonical(kplus.get_left_kmer(), id1, dna);
+			if (in_pass(id1))
+				vec.push_back(kplus);
+		}
+		sort(vec.begin(), vec.end(), kplus_less);
+		u32 min_count = (bloom_mb > 0) ? 2 : 1; //the pre-filter drops most k+1 mers seen once
+		vector<u8> codes;
+		for (size_t i = 0; i < vec.size(); i += STORE_GROUP_SIZE)
+		{
+			size_t end = (i + STORE_GROUP_SIZE < vec.size()) ? i + STORE_GROUP_SIZE : vec.size();
+			codes.clear();
+			k_mer prev = 0;
+			for (size_t j = i; j < end; j++)
+			{
+				append_vint64(codes, vec[j].id - prev);
+				append_vint64(codes, vec[j].count);
+				prev = vec[j].id;
+			}
+			store_writer->check();
+			store_writer->m << min_count;
+			store_writer->m << (u32)(end - i);
+			store_writer->m << codes;
+			store_writer->end_record();
+		}
+	}
+
+	//exits if "inpath" is not a count store
+	static void check_store(RecordReader & reader, const char* inpath)
+	{
+		if (!reader.empty && reader.type() != REC_KPLUS_STORE)
+		{
+			fprintf(stderr, "%s is not a k+1 mer count store!\n", inpath);
+			exit(-1);
+		}
+	}
+
+	//the number of k+1 mers in store files "splits", from the "num" of their records
+	long long store_entries(vector<string> & splits)
+	{
+		long long entries = 0;
+		hdfsFS fs = getHdfsFS();
+		u32 min_count, num;
+		vector<u8> codes;
+		for (size_t i = 0; i < splits.size(); i++)
+		{
+			const char* inpath = splits[i].c_str();
+			hdfsFile in = getRHandle(inpath, fs);
+			RecordReader reader(fs, in, inpath);
+			check_store(reader, inpath);
+			while (reader.next())
+			{
+				reader.in() >> min_count;
+				reader.in() >> num;
+				reader.in() >> codes;
+				entries += num;
+			}
+			hdfsCloseFile(fs, in);
 		}
-		delete writer;
 		hdfsDisconnect(fs);
+		return entries;
 	}
 
-	//=======================================================
-	// run the worker
-	void run(const WorkerParams& params)
+	//the k+1 mers of store file "inpath": added to the vertices if "parts" is NULL (DeBruijn_FromStore()),
+	//otherwise those of the current pass are put into "parts" by owner (incremental mode)
+	void load_store(const char* inpath, vector<KPlusVector>* parts)
 	{
-		//check path + init
-		if (_my_rank == MASTER_RANK)
+		hdfsFS fs = getHdfsFS();
+		hdfsFile in = getRHandle(inpath, fs);
+		RecordReader reader(fs, in, inpath);
+		check_store(reader, inpath);
+		u32 min_count, num;
+		vector<u8> codes;
+		while (reader.next())
 		{
-			if (dirCheck(params.input_path.c_str(), params.output_path.c_str(), _my_rank == MASTER_RANK, params.force_write) == -1)
+			reader.in() >> min_count;
+			reader.in() >> num;
+			reader.in() >> codes;
+			if ((int)min_count > freq_threshold)
+			{
+				fprintf(stderr, "%s keeps the k+1 mers seen at least %u times, but freq_t = %d!\n", inpath, min_count, freq_threshold);
+				exit(-1);
+			}
+			if (parts != NULL && min_count > 1)
+			{
+				//the k+1 mers seen once in the earlier reads may be seen again in the new ones, they must all be in the base store
+				fprintf(stderr, "%s was written with bloom_mb > 0 and lacks the k+1 mers seen once, it cannot be a base store!\n", inpath);
 				exit(-1);
+			}
+			if (num == 0)
+				continue; //"codes" is empty
+			u8* p = &codes[0];
+			KPlus_mer kplus;
+			for (u32 i = 0; i < num; i++)
+			{
+				kplus.id += parse_vint64(p);
+				kplus.count = parse_vint64(p);
+				if (parts != NULL)
+				{
+					if (store_kplus_in_pass(kplus))
+						(*parts)[kplus_owner_of(kplus.id)].push_back(kplus);
+				}
+				else if (kplus.count >= freq_threshold)
+					add_vertex(kplus);
+			}
 		}
-		init_timers();
+		hdfsCloseFile(fs, in);
+		hdfsDisconnect(fs);
+	}
 
-		//dispatch splits
-		ResetTimer(WORKER_TIMER);
-		vector<vector<string> >* arrangement;
+	//==============================
+	//incremental mode: the reads in the input path are new reads, and the counts of the earlier reads are
+	//in the count store at base_store_path, the store is re-partitioned to the owners of its k+1 mers,
+	//which may differ from those of the run that wrote it, and added to the counts of the new reads
+	//before the vertices are built, so the cost of a run follows the new reads, plus one pass over the store
+	//(a dumped graph cannot be used instead, as it lacks the k+1 mers below freq_t)
+
+	//the worker that holds the counts of a k+1 mer when add_vertices() is called
+	inline int kplus_owner_of(k_mer id)
+	{
+		return (dna.minimizer_len > 0) ? kplus_owner(id, dna) : kplus_hash(id);
+	}
+
+	inline bool store_kplus_in_pass(KPlus_mer & kplus)
+	{
+		if (num_passes == 1)
+			return true;
+		k_mer id1, id2;
+		vid2canonical(kplus.get_left_kmer(), id1, dna);
+		vid2canonical(kplus.get_right_kmer(dna), id2, dna);
+		return in_pass(id1) || in_pass(id2);
+	}
+
+	void merge_base_store()
+	{
+		vector<KPlusVector> parts(_num_workers);
+		for (size_t i = 0; i < base_splits.size(); i++)
+			load_store(base_splits[i].c_str(), &parts);
+		all_to_all(parts);
+		for (int i = 0; i < _num_workers; i++)
+		{
+			KPlusVector & vec = parts[i];
+			for (size_t j = 0; j < vec.size(); j++)
+				add_kplus_mer(vec[j].id, vec[j].count);
+			KPlusVector().swap(vec);
+		}
+	}
+
+	//==============================
+
+	//the edges of "kplus" in the vertices of the current pass
+	inline void add_vertex(KPlus_mer & kplus)
+	{
+		k_mer id1, id2;
+		bool v1_pol = vid2canonical(kplus.get_left_kmer(), id1, dna);
+		bool v2_pol = vid2canonical(kplus.get_right_kmer(dna), id2, dna);
+		int shift = getShift(v1_pol, v2_pol);
+		//------
+		if(in_pass(id1))
+			vertexes.get(id1).set_edgeBit(kplus.get_rightmost(), false, shift, kplus.count);
+		if(in_pass(id2))
+			vertexes.get(id2).set_edgeBit(kplus.get_leftmost(dna), true, shift, kplus.count);
+	}
+
+	void add_vertices()
+	{
+		if (!base_store_path.empty())
+			merge_base_store();
+		if (store_writer != NULL)
+			store_kplus_mers();
+		for (size_t i = 0; i < kplus_mers.capacity(); i++)
+		{
+			if (!kplus_mers.used(i))
+				continue;
+			KPlus_mer & kplus = kplus_mers.slots[i];
+			if (kplus.count < freq_threshold)
+				continue; //filter out low-freq k+1 mers
+			add_vertex(kplus);
+		}
+		kplus_mers.clear();
+	}
+
+	void reduce_kplus_mers()
+	{
+		if (stream_cache_mb > 0)
+		{
+			add_vertices(); //the k+1 mers were merged while streaming
+			return;
+		}
+		if (dna.minimizer_len > 0)
+		{
+			reduce_super_kmers();
+			add_vertices();
+			return;
+		}
+		vector<KPlusVector> _loaded_parts(_num_workers);
+		if (num_threads > 1)
+		{
+			vector<thread> mergers;
+			for(int t = 0; t < num_threads; t++)
+				mergers.push_back(thread(&DeBruijn::merge_thread_tables, this, ref(_loaded_parts), t, num_threads));
+			for(int t = 0; t < num_threads; t++)
+				mergers[t].join();
+			vector<vector<KPlusTable> >().swap(thread_tables);
+		}
+		else
+		{
+			for (size_t i = 0; i < kplus_mers.capacity(); i++)
+			{
+				if (!kplus_mers.used(i))
+					continue;
+				KPlus_mer & kplus = kplus_mers.slots[i];
+				_loaded_parts[kplus_hash(kplus.id)].push_back(kplus);
+			}
+		}
+		kplus_mers.clear();
+		//------
+		all_to_all(_loaded_parts);
+		size_t total = 0;
+		for(int i = 0; i < _num_workers; i++)
+			total += _loaded_parts[i].size();
+		kplus_mers.init(total + total / 2); //no rehash while merging
+		for(int i = 0; i < _num_workers; i++)
+		{
+			KPlusVector & vec = _loaded_parts[i];
+			for (size_t j = 0; j < vec.size(); j++)
+				add_kplus_mer(vec[j].id, vec[j].count);
+			KPlusVector().swap(vec);
+		}
+		vector<KPlusVector>().swap(_loaded_parts);
+		//------
+		add_vertices();
+	};
+
+	//==================================
+	void sync_graph()
+	{
+		vector<VertexVector> _loaded_parts(_num_workers);
+		for (size_t i = 0; i < vertexes.capacity(); i++)
+		{
+			if (vertexes.used(i))
+				_loaded_parts[hash(vertexes.slots[i].id)].push_back(vertexes.slots[i]);
+		}
+		vertexes.clear();
+		all_to_all(_loaded_parts);
+		size_t total = 0;
+		for (int i = 0; i < _num_workers; i++)
+			total += _loaded_parts[i].size();
+		vertexes.init(total + total / 2); //no rehash while merging
+		for (int i = 0; i < _num_workers; i++)
+		{
+			VertexVector & vec = _loaded_parts[i];
+			for(size_t j = 0; j < vec.size(); j++)
+				vertexes.get(vec[j].id).merge(vec[j]);
+			VertexVector().swap(vec);
+		}
+	};
+
+	void load_graph(const char* inpath)
+	{
+		hdfsFS fs = getHdfsFS();
+		bool packed = is_packed_reads(fs, inpath);
+		hdfsFile in = getRHandle(inpath, fs);
+		if (packed)
+		{
+			PackedReader reader(fs, in, inpath);
+			PackedBlock block;
+			while (reader.next(block))
+				parse_packed_block(block, NULL, (dna.minimizer_len > 0) ? &super_bufs[0] : NULL);
+		}
+		else
+		{
+			SeqReader reader(fs, in);
+			long long num_reads = 0;
+			while (reader.next())
+			{
+				add_kplus_mers(reader.seq);
+				if (stream != NULL && ++num_reads % STREAM_POLL_READS == 0)
+					poll_stream();
+			}
+		}
+		hdfsCloseFile(fs, in);
+		hdfsDisconnect(fs);
+		//cout<<"Worker "<<_my_rank<<": \""<<inpath<<"\" loaded"<<endl;//DEBUG !!!!!!!!!!
+	}
+
+	//the main thread reads the splits and hands blocks of reads to "num_threads" parser threads
+	void load_graph_parallel(vector<string> & splits)
+	{
+		ReadBlockQueue queue(4 * num_threads);
+		vector<thread> parsers;
+		if (dna.minimizer_len > 0)
+		{
+			for(int t = 0; t < num_threads; t++)
+				parsers.push_back(thread(&DeBruijn::parse_blocks_super, this, ref(queue), ref(super_bufs[t])));
+		}
+		else
+		{
+			thread_tables.assign(num_threads, vector<KPlusTable>(_num_workers));
+			for(int t = 0; t < num_threads; t++)
+				parsers.push_back(thread(&DeBruijn::parse_blocks, this, ref(queue), ref(thread_tables[t])));
+		}
+		//------
+		hdfsFS fs = getHdfsFS();
+		for(size_t i = 0; i < splits.size(); i++)
+		{
+			const char* path = splits[i].c_str();
+			bool packed = is_packed_reads(fs, path);
+			hdfsFile in = getRHandle(path, fs);
+			if (packed)
+			{
+				PackedReader reader(fs, in, path);
+				ReadBlock* block = new ReadBlock(true);
+				while (reader.next(block->packed))
+				{
+					queue.push(block);
+					block = new ReadBlock(true);
+				}
+				delete block;
+				hdfsCloseFile(fs, in);
+				continue;
+			}
+			SeqReader reader(fs, in);
+			ReadBlock* block = new ReadBlock(false);
+			block->text.reserve(HDFS_BUF_SIZE + LINE_DEFAULT_SIZE);
+			while (reader.next())
+			{
+				block->text.append(reader.seq, reader.length);
+				block->text.push_back('\n');
+				if (block->text.size() >= HDFS_BUF_SIZE)
+				{
+					queue.push(block);
+					block = new ReadBlock(false);
+					block->text.reserve(HDFS_BUF_SIZE + LINE_DEFAULT_SIZE);
+				}
+			}
+			queue.push(block);
+			hdfsCloseFile(fs, in);
+		}
+		hdfsDisconnect(fs);
+		//------
+		queue.close();
+		for(int t = 0; t < num_threads; t++)
+			parsers[t].join();
+	}
+
+	void load_splits(vector<string> & splits)
+	{
+		if (dna.minimizer_len > 0)
+			super_bufs.assign(num_threads, vector<SuperKmerBuffer>(_num_workers));
+		if (stream_cache_mb > 0 && !bloom_pass)
+			begin_stream();
+		if (reads_in_memory())
+			load_unique_reads();
+		else if (num_threads > 1)
+			load_graph_parallel(splits);
+		else
+		{
+			for (vector<string>::iterator it = splits.begin(); it != splits.end(); it++)
+				load_graph(it->c_str());
+		}
+		if (stream != NULL)
+			finish_stream();
+	}
+
+	//==============================
+	void dump_vertices(RecordWriter* writer)
+	{
+		vector<u8> freqs;
+		for (size_t i = 0; i < vertexes.capacity(); i++)
+		{
+			if (!vertexes.used(i))
+				continue;
+			DNAVertex * v = &vertexes.slots[i];
+			v->get_freqs(freqs);
+			writer->check();
+			writer->m << v->id;
+			writer->m << v->bitmap;
+			writer->m << freqs;
+			writer->end_record();
+		}
+	}
+
+	void dump_vertices(BufferedWriter* writer)
+	{
+		char buf[100];
+		vector<u8> vec;
+		for (size_t i = 0; i < vertexes.capacity(); i++)
+		{
+			if (!vertexes.used(i))
+				continue;
+			writer->check();
+			//writer->write((*it)->toString().c_str());
+			// Adding....
+			DNAVertex * v = &vertexes.slots[i];
+			v->get_freqs(vec);
+			sprintf(buf, KMER_FMT "\t%u %d", v->id, v->bitmap, vec.size());
+			writer->write(buf);
+			for(int i=0; i<vec.size(); i++)
+			{
+				sprintf(buf, " %hhu", vec[i]);
+				writer->write(buf);
+			}
+			//.................
+			writer->write("\n");
+		}
+	}
+
+	//=======================================================
+	//checks the paths, then dispatches the splits of the input path
+	void scatter_splits(const char* path, bool native_dispatcher, vector<string> & assignedSplits)
+	{
 		if (_my_rank == MASTER_RANK)
 		{
-			arrangement = params.native_dispatcher ? dispatchLocality(params.input_path.c_str()) : dispatchRan(params.input_path.c_str());
+			vector<vector<string> >* arrangement;
+			arrangement = native_dispatcher ? dispatchLocality(path) : dispatchRan(path);
 			//reportAssignment(arrangement);//DEBUG !!!!!!!!!!
 			masterScatter(*arrangement);
-			vector<string>& assignedSplits = (*arrangement)[0];
-			//reading assigned splits (map)
-			for (vector<string>::iterator it = assignedSplits.begin();
-			        it != assignedSplits.end(); it++)
-				load_graph(it->c_str());
+			assignedSplits.swap((*arrangement)[0]);
 			delete arrangement;
 		}
 		else
-		{
-			vector<string> assignedSplits;
 			slaveScatter(assignedSplits);
-			//reading assigned splits (map)
-			for (vector<string>::iterator it = assignedSplits.begin();
-			        it != assignedSplits.end(); it++)
-				load_graph(it->c_str());
-		}
-		StopTimer(WORKER_TIMER);
-		PrintTimer("Load Time", WORKER_TIMER);
+	}
 
-		//send vertices according to hash_id (reduce)
-		ResetTimer(WORKER_TIMER);
-		reduce_kplus_mers();
-		sync_graph();
+	void dispatch_splits(const WorkerParams& params, vector<string> & assignedSplits)
+	{
+		if (_my_rank == MASTER_RANK)
+		{
+			if (dirCheck(params.input_path.c_str(), params.output_path.c_str(), _my_rank == MASTER_RANK, params.force_write) == -1)
+				exit(-1);
+			if (!base_store_path.empty() && base_store_path == store_path)
+			{
+				fprintf(stderr, "The count store %s cannot be both read and written!\n", store_path.c_str());
+				exit(-1);
+			}
+			if (!store_path.empty() && dirCheck(store_path.c_str(), params.force_write) == -1)
+				exit(-1);
+		}
+		init_timers();
 
-		//sync_graph();
-		StopTimer(WORKER_TIMER);
-		PrintTimer("Sync Time", WORKER_TIMER);
+		scatter_splits(params.input_path.c_str(), params.native_dispatcher, assignedSplits);
+		if (!base_store_path.empty())
+			scatter_splits(base_store_path.c_str(), params.native_dispatcher, base_splits);
+	}
 
-		//dump De Bruijn graph
+	void dump_pass(BufferedWriter* writer, RecordWriter* rec_writer)
+	{
 		ResetTimer(WORKER_TIMER);
-		dump_partition(params.output_path.c_str());
+		if (binary_stage_io)
+			dump_vertices(rec_writer);
+		else
+			dump_vertices(writer);
+		vertexes.clear();
 		StopTimer(WORKER_TIMER);
 		PrintTimer("Dump Time", WORKER_TIMER);
 	}
+
+	//=======================================================
+	// run the worker
+	void run(const WorkerParams& params)
+	{
+		vector<string> assignedSplits;
+		dispatch_splits(params, assignedSplits);
+
+		long long held = (bloom_mb > 0) ? ((long long)bloom_mb << 20) : 0; //"solid" stays through the counting passes
+		if (reads_in_memory())
+		{
+			ResetTimer(WORKER_TIMER);
+			prepare_reads(assignedSplits);
+			StopTimer(WORKER_TIMER);
+			PrintTimer("Prepare Time", WORKER_TIMER);
+			held += unique_reads.capacity() + read_counts.capacity() * sizeof(u32);
+		}
+		if (mem_budget_mb > 0)
+		{
+			long long kplus = input_bytes(assignedSplits);
+			if (!base_store_path.empty())
+				kplus += store_entries(base_splits); //also counted in the passes
+			set_num_passes(kplus, held);
+		}
+
+		if (bloom_mb > 0)
+		{
+			ResetTimer(WORKER_TIMER);
+			build_solid_filter(assignedSplits);
+			StopTimer(WORKER_TIMER);
+			PrintTimer("Bloom Time", WORKER_TIMER);
+		}
+
+		hdfsFS fs = getHdfsFS();
+		BufferedWriter* writer = NULL;
+		RecordWriter* rec_writer = NULL;
+		if (binary_stage_io)
+			rec_writer = new RecordWriter(params.output_path.c_str(), fs, _my_rank, REC_DBG_VERTEX);
+		else
+			writer = new BufferedWriter(params.output_path.c_str(), fs, _my_rank);
+		if (!store_path.empty())
+			store_writer = new RecordWriter(store_path.c_str(), fs, _my_rank, REC_KPLUS_STORE);
+		for (cur_pass = 0; cur_pass < num_passes; cur_pass++)
+		{
+			//reading assigned splits (map)
+			ResetTimer(WORKER_TIMER);
+			load_splits(assignedSplits);
+			StopTimer(WORKER_TIMER);
+			PrintTimer("Load Time", WORKER_TIMER);
+
+			//send vertices according to hash_id (reduce)
+			ResetTimer(WORKER_TIMER);
+			reduce_kplus_mers();
+			sync_graph();
+			StopTimer(WORKER_TIMER);
+			PrintTimer("Sync Time", WORKER_TIMER);
+
+			//dump De Bruijn graph
+			dump_pass(writer, rec_writer);
+		}
+		delete writer;
+		delete rec_writer;
+		delete store_writer;
+		store_writer = NULL;
+		hdfsDisconnect(fs);
+		solid.clear();
+		string().swap(unique_reads);
+		vector<u32>().swap(read_counts);
+	}
+
+	//builds the graph from a count store, params.input_path is the store
+	void run_from_store(const WorkerParams& params)
+	{
+		vector<string> assignedSplits;
+		dispatch_splits(params, assignedSplits);
+		if (mem_budget_mb > 0)
+			set_num_passes(store_entries(assignedSplits));
+
+		hdfsFS fs = getHdfsFS();
+		BufferedWriter* writer = NULL;
+		RecordWriter* rec_writer = NULL;
+		if (binary_stage_io)
+			rec_writer = new RecordWriter(params.output_path.c_str(), fs, _my_rank, REC_DBG_VERTEX);
+		else
+			writer = new BufferedWriter(params.output_path.c_str(), fs, _my_rank);
+		for (cur_pass = 0; cur_pass < num_passes; cur_pass++)
+		{
+			ResetTimer(WORKER_TIMER);
+			for (size_t i = 0; i < assignedSplits.size(); i++)
+				load_store(assignedSplits[i].c_str(), NULL);
+			StopTimer(WORKER_TIMER);
+			PrintTimer("Load Time", WORKER_TIMER);
+
+			ResetTimer(WORKER_TIMER);
+			sync_graph();
+			StopTimer(WORKER_TIMER);
+			PrintTimer("Sync Time", WORKER_TIMER);
+
+			dump_pass(writer, rec_writer);
+		}
+		delete writer;
+		delete rec_writer;
+		hdfsDisconnect(fs);
+	}
 };
 
 
-void DeBruijn_Build(string in_path, string outpath, int kmer, int freq_t)
+void DeBruijn_Build(string in_path, string outpath, const DeBruijnOptions & opt)
 {
 	WorkerParams deBruijn_p;
 	deBruijn_p.input_path= in_path;
@@ -564,9 +2298,43 @@ void DeBruijn_Build(string in_path, string outpath, int kmer, int freq_t)
 	deBruijn_p.force_write=true;
 	deBruijn_p.native_dispatcher=false;
 	//	init_workers();
-	DeBruijn deBruijn(kmer, freq_t);
+	DeBruijn deBruijn(opt);
+	deBruijn.store_path = opt.store_path;
+	deBruijn.base_store_path = opt.base_store_path;
+	if (!opt.base_store_path.empty() && deBruijn.bloom_mb > 0)
+	{
+		//the pre-filter only sees the new reads, it would drop their k+1 mers seen once before the earlier counts are added
+		if (_my_rank == MASTER_RANK)
+			fprintf(stderr, "bloom_mb is ignored with BaseKPlusStore_PATH, the pre-filter does not see the earlier reads\n");
+		deBruijn.bloom_mb = 0;
+	}
+	if (deBruijn.mem_budget_mb > 0 && 3LL * deBruijn.bloom_mb > deBruijn.mem_budget_mb)
+	{
+		//see build_solid_filter()
+		if (_my_rank == MASTER_RANK)
+			fprintf(stderr, "Building the Bloom pre-filter takes about 3 * bloom_mb = %d MB, more than mem_budget_mb = %d!\n", 3 * deBruijn.bloom_mb, deBruijn.mem_budget_mb);
+		exit(-1);
+	}
 	deBruijn.run(deBruijn_p);
 	//	worker_finalize();
 }
 
+//builds the graph from the count store written by DeBruijn_Build() at opt.store_path, for any freq_t, without reading the reads
+//the store must have been written with the same k, only k_mer_t, minimizer_t, freq_t and mem_budget_mb of "opt" apply
+void DeBruijn_FromStore(string outpath, const DeBruijnOptions & opt)
+{
+	WorkerParams deBruijn_p;
+	deBruijn_p.input_path= opt.store_path;
+	deBruijn_p.output_path= outpath;
+	deBruijn_p.force_write=true;
+	deBruijn_p.native_dispatcher=false;
+	DeBruijnOptions store_opt;
+	store_opt.k_mer_t = opt.k_mer_t;
+	store_opt.minimizer_t = opt.minimizer_t;
+	store_opt.freq_t = opt.freq_t;
+	store_opt.mem_budget_mb = opt.mem_budget_mb;
+	DeBruijn deBruijn(store_opt);
+	deBruijn.run_from_store(deBruijn_p);
+}
+
 #endif
@@ -3,6 +3,9 @@
 
 #include <vector>
 #include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include "utils/record_io.h"
 using namespace std;
 
 #define u8 unsigned char
@@ -11,34 +14,29 @@ using namespace std;
 
 
 //================================= VINT BEGIN =================================
-u8 vint_buf[5]; //buffer for holding the vlength-bytes of a number
-u8 vint_bytes; //number of bytes
+//7 bits per byte, lowest first, 0x80 marks the last byte
+//the functions keep no state, so threads may encode and decode at the same time
 
-void append_vint(vector<u8> & collector) //set number_buf & number_bytes properly first
-{
-	for(int i=0; i<vint_bytes; i++) collector.push_back(vint_buf[i]);
-}
-
-//-----------------
+const int MAX_VINT_BYTES = 5; //of a u32
 
-void to_vint(u32 i)
+//writes the bytes of "i" to "buf" (room for MAX_VINT_BYTES), returns their number
+inline int to_vint(u32 i, u8 * buf)
 {
-	if(i == 0)
+	int bytes = 0;
+	while(i >= 0x80)
 	{
-		vint_buf[0] = 0x80;
-		vint_bytes = 1;
-	}
-	else //i > 0
-	{
-		vint_bytes = 0;
-		while(i)
-		{
-			vint_buf[vint_bytes] = (i & 0x7f);
-			vint_bytes ++;
-			i >>= 7;
-		}
-		vint_buf[vint_bytes - 1] |= 0x80;
+		buf[bytes++] = i & 0x7f;
+		i >>= 7;
 	}
+	buf[bytes++] = i | 0x80;
+	return bytes;
+}
+
+void append_vint(vector<u8> & collector, u32 i)
+{
+	u8 buf[MAX_VINT_BYTES];
+	int bytes = to_vint(i, buf);
+	collector.insert(collector.end(), buf, buf + bytes);
 }
 
 u32 parse_vint(u8 * & head)
@@ -66,11 +64,52 @@ void parse_vints(vector<u32> & collector, vector<u8> & vec_vints)
 		collector.push_back(cur);
 	}
 }
+//-----------------
+//64-bit numbers (e.g., k_mer deltas), with the same byte layout
+
+void append_vint64(vector<u8> & collector, u64 i)
+{
+	while(i >= 0x80)
+	{
+		collector.push_back(i & 0x7f);
+		i >>= 7;
+	}
+	collector.push_back(i | 0x80);
+}
+
+u64 parse_vint64(u8 * & head)
+{
+	u64 ret = 0;
+	int shift = 0;
+	while(!(*head & 0x80))
+	{
+		ret |= (u64)(*head++) << shift;
+		shift += 7;
+	}
+	ret |= (u64)(*head++ & 0x7f) << shift;
+	return ret;
+}
 //================================= VINT END =================================
 
 
 //================================= K-MER BEGIN =================================
+//k_mer word width is fixed at compile time: build with -DKMER_BITS=32 for k <= 15,
+//which halves vertex IDs and messages; a k+1 mer must fit in one word
+#ifndef KMER_BITS
+#define KMER_BITS 64
+#endif
+
+#if KMER_BITS == 32
+typedef u32 k_mer;
+#define KMER_FMT "%u"
+#elif KMER_BITS == 64
 typedef u64 int k_mer;
+#define KMER_FMT "%llu"
+#else
+#error "KMER_BITS must be 32 or 64"
+#endif
+
+static const int MAX_MER_LENGTH = KMER_BITS / 2 - 1;
 
 //mapping:
 // A: 00
@@ -99,15 +138,71 @@ static const u8 outC = 0x01;
 static const u8 ATGC_bits[8] = {inA, inT, inG, inC, outA, outT, outG, outC};
 static const k_mer bit2ATGC[8] = {A, T, G, C, A, T, G, C};
 
-int mer_length;
-k_mer kick;
-k_mer END_MER;
-k_mer NULL_MER = 0x8000000000000000; //k-mer does not use the highest 2 bits
+//bit b of a 32-bit vertex bitmap -> the edge as a neighbor_info bitmap (ATGC << 3 | in << 2 | left_isH << 1 | right_isH)
+//byte 3, 2, 1, 0 of the vertex bitmap is LL, LH, HL, HH (see getShift()), and its bits 7 to 0 are inA ... outC
+static const u8 edge_info[32] = {
+	0x0B, 0x13, 0x1B, 0x03, 0x0F, 0x17, 0x1F, 0x07, //HH
+	0x0A, 0x12, 0x1A, 0x02, 0x0E, 0x16, 0x1E, 0x06, //HL
+	0x09, 0x11, 0x19, 0x01, 0x0D, 0x15, 0x1D, 0x05, //LH
+	0x08, 0x10, 0x18, 0x00, 0x0C, 0x14, 0x1C, 0x04  //LL
+};
+
+k_mer NULL_MER = (k_mer)1 << (KMER_BITS - 1); //k-mer does not use the highest 2 bits
+
+//====================================
+//the k-dependent constants and the parameters of a stage, passed to the functions below that need them,
+//so that several k values or threads can use them in one process
+struct DnaContext
+{
+	int mer_length; //k
+	k_mer kick; //the 2k bits of a k_mer, "kicks out" the bits above
+	k_mer end_mer; //the bit above a k_mer, marks a contig end in the preds of ListRank/SV
+	int minimizer_len; //m of MinimizerHash, 0 = minimizer partitioning is off (DefaultHash)
+	int tip_threshold; //AmbiConnect and TipRemoval: a tip of up to this many bases (k - 1 + tip_t) is removed
+
+	DnaContext()
+	{
+		mer_length = 0;
+		kick = 0;
+		end_mer = 0;
+		minimizer_len = 0;
+		tip_threshold = 0;
+	}
+
+	void init(int len, int minimizer = 0)
+	{
+		if(len < 1 || len > MAX_MER_LENGTH)
+		{
+			fprintf(stderr, "k_mer_t = %d is not supported by this build (KMER_BITS = %d, k <= %d)!\n", len, KMER_BITS, MAX_MER_LENGTH);
+			exit(-1);
+		}
+		if(minimizer < 0 || minimizer > len)
+		{
+			fprintf(stderr, "minimizer length %d must be in [0, k = %d]!\n", minimizer, len);
+			exit(-1);
+		}
+		mer_length = len;
+		kick = 0xFFFFFFFFFFFFFFFF >> (64 - 2 * mer_length);
+		end_mer = (k_mer)1 << (2 * mer_length);
+		minimizer_len = minimizer;
+	}
+};
+
+//each stage worker owns its DnaContext, the code that the framework calls without the worker at hand
+//(vertices, aggregators and HashT functors) reaches it through global_dna, as Worker's own objects are
+//reached through global_agg and global_combiner; the worker's own code takes it as a parameter
+const DnaContext* global_dna = NULL;
+
+inline const DnaContext & stage_dna()
+{
+	return *global_dna;
+}
 
-void set_mer_length(int len)
+//makes "dna" the context of the stage being run, whose records are written and checked with its k
+void set_stage_dna(const DnaContext & dna)
 {
-	mer_length = len;
-	kick = 0xFFFFFFFFFFFFFFFF >> (64 - 2 * mer_length);
+	global_dna = &dna;
+	record_k = dna.mer_length;
 }
 
 void convert(k_mer val, char* buf, int length)
@@ -123,18 +218,22 @@ void convert(k_mer val, char* buf, int length)
 	}
 }
 
-k_mer getRC(k_mer id)
+//reverse complement in O(1): complement all bases (A <-> T, C <-> G is x ^ 3),
+//reverse the order of the 2-bit bases in the whole word (swap bases in nibbles, nibbles in bytes, then the bytes),
+//and shift the k bases, now at the top of the word, down to the bottom (bits above 2k are shifted out)
+inline k_mer getRC(k_mer id, const DnaContext & dna)
 {
-	k_mer rc = 0;
-	for(int i = 0; i < mer_length; i++)
-	{
-		k_mer tag =  id & 3ull; //last 2 bits
-		tag ^= 3ull; //complement
-		rc |= tag; //append to rc
-		id >>= 2; //next 2 bits
-		if(i != mer_length - 1) rc <<= 2;
-	}
-	return rc;
+	k_mer x = ~id;
+#if KMER_BITS == 32
+	x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+	x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+	x = __builtin_bswap32(x);
+#else
+	x = ((x >> 2) & 0x3333333333333333ull) | ((x & 0x3333333333333333ull) << 2);
+	x = ((x >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((x & 0x0F0F0F0F0F0F0F0Full) << 4);
+	x = __builtin_bswap64(x);
+#endif
+	return x >> (KMER_BITS - 2 * dna.mer_length);
 }
 
 int getShift(bool v1_pol, bool v2_pol)//four bytes, each for LL, LH, HL, and HH
@@ -145,69 +244,41 @@ int getShift(bool v1_pol, bool v2_pol)//four bytes, each for LL, LH, HL, and HH
 	return shift;
 }
 
-k_mer get_neighbor(k_mer id, u8 bit, bool v1_pol, bool v2_pol)  //id is the ID of the current vertex
+//the neighbor at the other end of an edge, "info" is the edge as a neighbor_info bitmap (- - - A A B C C, see below)
+//an in-edge prepends the base to the left end of the vertex, an out-edge appends it to the right end,
+//the vertex is first taken in the polarity of the end the edge leaves from, and the result in the polarity of the other end
+//"id_rc" is getRC(id), so a batch of edges of the same vertex reverses it once
+inline k_mer neighbor_of(k_mer id, k_mer id_rc, u8 info, const DnaContext & dna)
 {
-	k_mer neighborID = id;
-	//------
-	if (bit == inA)
-	{
-		if(v2_pol) neighborID = getRC(id);
-		neighborID >>= 2;
-		if(v1_pol) neighborID = getRC(neighborID);
-	}
-	else if (bit == inT)
-	{
-		if(v2_pol) neighborID = getRC(id);
-		neighborID >>= 2;
-		neighborID |= (T << (2 * mer_length - 2));
-		if(v1_pol) neighborID = getRC(neighborID);
-	}
-	else if (bit == inG)
-	{
-		if(v2_pol) neighborID = getRC(id);
-		neighborID >>= 2;
-		neighborID |= (G << (2 * mer_length - 2));
-		if(v1_pol) neighborID = getRC(neighborID);
-	}
-	else if (bit == inC)
-	{
-		if(v2_pol) neighborID = getRC(id);
-		neighborID >>= 2;
-		neighborID |= (C << (2 * mer_length - 2));
-		if(v1_pol) neighborID = getRC(neighborID);
-	}
-	else if (bit == outA)
-	{
-		if(v1_pol) neighborID = getRC(id);
-		neighborID <<= 2;
-		neighborID &= kick; //kick out highest two bits
-		if(v2_pol) neighborID = getRC(neighborID);
-	}
-	else if (bit == outT)
-	{
-		if(v1_pol) neighborID = getRC(id);
-		neighborID <<= 2;
-		neighborID &= kick;
-		neighborID |= T;
-		if(v2_pol) neighborID = getRC(neighborID);
-	}
-	else if (bit == outG)
-	{
-		if(v1_pol) neighborID = getRC(id);
-		neighborID <<= 2;
-		neighborID &= kick;
-		neighborID |= G;
-		if(v2_pol) neighborID = getRC(neighborID);
-	}
-	else if (bit == outC)
+	k_mer base = info >> 3;
+	bool in = info & 0x04;
+	bool src_H = in ? (info & 0x01) : (info & 0x02);
+	bool dst_H = in ? (info & 0x02) : (info & 0x01);
+	k_mer src = src_H ? id_rc : id;
+	k_mer nb = in ? ((src >> 2) | (base << (2 * dna.mer_length - 2))) : (((src << 2) & dna.kick) | base);
+	return dst_H ? getRC(nb, dna) : nb;
+}
+
+k_mer get_neighbor(k_mer id, u8 bit, bool v1_pol, bool v2_pol, const DnaContext & dna)  //id is the ID of the current vertex
+{
+	u8 info = (edge_info[__builtin_ctz(bit)] & 0x1C) | (v1_pol << 1) | (u8)v2_pol;
+	return neighbor_of(id, getRC(id, dna), info, dna);
+}
+
+//batched neighbor enumeration over a 32-bit vertex bitmap (see DNAVertex in DeBruijn.h),
+//edges are visited from bit 31 down to bit 0, the order of the loops over (v1_pol, v2_pol) and ATGC_bits,
+//at most "max" of them, returns the number written to "out" (room for 32 is always enough)
+int enum_neighbors(k_mer id, u32 bitmap, k_mer* out, int max, const DnaContext & dna)
+{
+	k_mer id_rc = getRC(id, dna);
+	int num = 0;
+	while(bitmap != 0 && num < max)
 	{
-		if(v1_pol) neighborID = getRC(id);
-		neighborID <<= 2;
-		neighborID &= kick;
-		neighborID |= C;
-		if(v2_pol) neighborID = getRC(neighborID);
+		int b = 31 - __builtin_clz(bitmap);
+		bitmap ^= (1u << b);
+		out[num++] = neighbor_of(id, id_rc, edge_info[b], dna);
 	}
-	return neighborID;
+	return num;
 }
 
 //special bitmap for dead end
@@ -305,12 +376,22 @@ struct neighbor_info
 	}
 };
 
-k_mer get_neighbor(k_mer me, neighbor_info nb)
+k_mer get_neighbor(k_mer me, neighbor_info nb, const DnaContext & dna)
 {
-	k_mer tag = nb.get_ATGC();
-	tag = bit_pos[tag];
-	if(nb.is_in()) tag <<= 4;
-	return get_neighbor(me, tag, nb.left_isH(), nb.right_isH());
+	return neighbor_of(me, getRC(me, dna), nb.bitmap & 0x1F, dna);
+}
+
+//same order as enum_neighbors()
+int enum_neighbor_infos(u32 bitmap, neighbor_info* out, int max)
+{
+	int num = 0;
+	while(bitmap != 0 && num < max)
+	{
+		int b = 31 - __builtin_clz(bitmap);
+		bitmap ^= (1u << b);
+		out[num++].bitmap = edge_info[b];
+	}
+	return num;
 }
 
 //========================== k-mer pair ==========================
@@ -377,9 +458,9 @@ struct kmer_pair
 	{
 		size_t seed = 0;
 		hash_combine(seed, v1);
-		hash_combine(seed, (v1 >> 32));
+		hash_combine(seed, (v1 >> (KMER_BITS / 2)));
 		hash_combine(seed, v2);
-		hash_combine(seed, (v2 >> 32));
+		hash_combine(seed, (v2 >> (KMER_BITS / 2)));
 		return seed % ((unsigned int)_num_workers);
 	}
 };
@@ -416,9 +497,9 @@ struct hash<kmer_pair>
 	{
 		size_t seed = 0;
 		hash_combine(seed, pair.v1);
-		hash_combine(seed, (pair.v1 >> 32));
+		hash_combine(seed, (pair.v1 >> (KMER_BITS / 2)));
 		hash_combine(seed, pair.v2);
-		hash_combine(seed, (pair.v2 >> 32));
+		hash_combine(seed, (pair.v2 >> (KMER_BITS / 2)));
 		return seed;
 	}
 };
@@ -426,9 +507,77 @@ struct hash<kmer_pair>
 
 //=======================================
 
+//a DNA sequence, 2 bits per base (the k_mer code) in 64-bit words, the first base in the highest bits of a word,
+//the bits after the last base are 0
+//it is serialized (and written in the text format) as bytes, byte i holding bases 4i to 4i + 3 from the highest bits,
+//the layout of the former vector<u8> version, so stage files are unchanged
+
+//internal use only! "n" bases (1 to 32) from base "pos" of "words", in the highest bits, the other bits are 0
+inline u64 get_bases(const u64* words, long long pos, int n)
+{
+	int w = pos >> 5;
+	int off = 2 * (pos & 31);
+	u64 x = words[w] << off;
+	if(off + 2 * n > 64) x |= words[w + 1] >> (64 - off);
+	if(n < 32) x &= ~0ull << (64 - 2 * n);
+	return x;
+}
+
+//internal use only! reverse complement of the 32 bases of a word, as in getRC()
+inline u64 rc_bases(u64 x)
+{
+	x = ~x;
+	x = ((x >> 2) & 0x3333333333333333ull) | ((x & 0x3333333333333333ull) << 2);
+	x = ((x >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((x & 0x0F0F0F0F0F0F0F0Full) << 4);
+	return __builtin_bswap64(x);
+}
+
+//bases [start, start + length) of an ATGC_bitmap, read as its reverse complement if "rc", without copying them
+//it points into the words of the bitmap, so it is valid until the bitmap changes
+struct ATGC_view
+{
+	const u64* words;
+	int start;
+	int length;
+	bool rc;
+
+	ATGC_view()
+	{
+		words = NULL;
+		start = 0;
+		length = 0;
+		rc = false;
+	}
+
+	k_mer get(int pos) const
+	{
+		long long i = rc ? (start + length - 1 - pos) : (start + pos);
+		k_mer tag = (words[i >> 5] >> (62 - 2 * (i & 31))) & 3;
+		return rc ? (tag ^ 3) : tag;
+	}
+
+	//"n" bases (1 to 32) from base "pos" of the view, in the highest bits, the other bits are 0
+	u64 bits(int pos, int n) const
+	{
+		if(!rc) return get_bases(words, start + pos, n);
+		u64 x = get_bases(words, start + length - pos - n, n);
+		return rc_bases(x) << (64 - 2 * n); //the complemented 0 bits end up at the top and are shifted out
+	}
+
+	//the view without its first "n" bases, e.g., the k-1 bases shared with the previous part of a contig
+	ATGC_view skip(int n) const
+	{
+		ATGC_view v = *this;
+		if(n > length) n = length;
+		v.length -= n;
+		if(!rc) v.start += n;
+		return v;
+	}
+};
+
 struct ATGC_bitmap
 {
-	vector<u8> seq;
+	vector<u64> words;
 	int length;
 
 	ATGC_bitmap()
@@ -436,88 +585,131 @@ struct ATGC_bitmap
 		length = 0;
 	}
 
-	void init(k_mer mer)
+	void init(k_mer mer, const DnaContext & dna)
 	{
-		length = mer_length;
-		//------
-		int byte_num = mer_length / 4;
-		int mod = mer_length % 4;
-		if(mod) byte_num++;
-		mer <<= (64 - 2*mer_length);//align to right
-		for(int i=0; i<byte_num; i++)
-		{
-			k_mer byte = mer >> 8*(7-i);
-			byte &= 0xFF;
-			seq.push_back(byte);
-		}
+		length = dna.mer_length;
+		words.assign(1, (u64)mer << (64 - 2 * length)); //align to left
+	}
+
+	void reserve(int num_bases)
+	{
+		words.reserve((num_bases + 31) / 32);
 	}
 
 	void append(k_mer tag)
 	{
-		length += 1;
-		//decide whether need to increase "seq"
-		int byte_num = length / 4;
-		int mod = length % 4;
-		if(mod) byte_num++;
-		if(byte_num > seq.size() || seq.size() == 0) seq.push_back(0);
-		//set the bits
-		if(mod == 0) seq.back() |= (u8)tag; //00 00 00 11
-		else if(mod == 1) seq.back() |= (u8)(tag << 6); //11 00 00 00
-		else if(mod == 2) seq.back() |= (u8)(tag << 4); //00 11 00 00
-		else seq.back() |= (u8)(tag << 2); //00 00 11 00
+		int off = 2 * (length & 31);
+		if(off == 0) words.push_back(0);
+		words.back() |= (u64)tag << (62 - off);
+		length++;
 	}
 
-	k_mer get(int pos)
+	//appends "n" bases (1 to 32) in the highest bits of "bits", the other bits must be 0
+	void append_bits(u64 bits, int n)
 	{
-		int byte_no = pos / 4;
-		int mod = pos % 4;
-		if(mod == 0) return (seq[byte_no] & 0xC0) >> 6;//11 00 00 00
-		else if(mod == 1) return (seq[byte_no] & 0x30) >> 4;//00 11 00 00
-		else if(mod == 2) return (seq[byte_no] & 0x0C) >> 2;//00 00 11 00
-		else return (seq[byte_no] & 0x03);//00 00 00 11
+		int off = 2 * (length & 31);
+		if(off == 0) words.push_back(bits);
+		else
+		{
+			words.back() |= bits >> off;
+			if(off + 2 * n > 64) words.push_back(bits << (64 - off));
+		}
+		length += n;
 	}
 
-	ATGC_bitmap get_reverse()
+	//appends the bases of "src" 32 at a time, "src" must not be a view of this bitmap
+	void append(const ATGC_view & src)
 	{
-		ATGC_bitmap rev;
-		for(int i = 0; i < length; i++)
+		reserve(length + src.length);
+		for(int pos = 0; pos < src.length; pos += 32)
 		{
-			rev.append(get(length - i -1) ^ 3ull);
+			int n = (src.length - pos < 32) ? src.length - pos : 32;
+			append_bits(src.bits(pos, n), n);
 		}
-		rev.length = length;
+	}
+
+	k_mer get(int pos) const
+	{
+		return (words[pos >> 5] >> (62 - 2 * (pos & 31))) & 3;
+	}
+
+	ATGC_view view(bool rc = false) const
+	{
+		ATGC_view v;
+		v.words = words.empty() ? NULL : &words[0];
+		v.length = length;
+		v.rc = rc;
+		return v;
+	}
+
+	ATGC_bitmap get_reverse() const
+	{
+		ATGC_bitmap rev;
+		rev.append(view(true));
 		return rev;
 	}
 
+	void swap(ATGC_bitmap & other)
+	{
+		words.swap(other.words);
+		std::swap(length, other.length);
+	}
+
+	//------
+	//the serialized bytes
+
+	int num_bytes() const
+	{
+		return (length + 3) / 4;
+	}
+
+	u8 get_byte(int i) const
+	{
+		return words[i >> 3] >> (56 - 8 * (i & 7));
+	}
+
+	//sets the bases from serialized bytes, "length" is set separately
+	void set_bytes(const u8* bytes, size_t size)
+	{
+		words.assign((size + 7) / 8, 0);
+		if(size > 0) memcpy(&words[0], bytes, size);
+		for(size_t i = 0; i < words.size(); i++)
+			words[i] = __builtin_bswap64(words[i]); //byte 0 to the highest bits
+	}
+
 	string toString()
 	{
-		string re;
+		static const char bases[4] = {'A', 'C', 'G', 'T'};
+		string re(length, 'A');
 		for(int i=0; i<length; i++)
-		{
-			k_mer cur = get(i);
-			if(cur == A) re += "A";
-			else if(cur == T) re += "T";
-			else if(cur == G) re += "G";
-			else if(cur == C) re += "C";
-		}
+			re[i] = bases[get(i)];
 		return re;
 	}
 
 	friend ibinstream& operator<<(ibinstream& m, const ATGC_bitmap& v)
 	{
-		m << v.seq;
+		size_t size = v.num_bytes();
+		m << size;
+		for(size_t i = 0; i < v.words.size(); i++)
+		{
+			u64 word = __builtin_bswap64(v.words[i]); //the highest bits to byte 0
+			m.raw_bytes(&word, (size - 8 * i < 8) ? size - 8 * i : 8);
+		}
 		m << v.length;
 		return m;
 	}
 
 	friend obinstream& operator>>(obinstream& m, ATGC_bitmap& v)
 	{
-		m >> v.seq;
+		size_t size;
+		m >> size;
+		v.set_bytes((const u8*)m.raw_bytes(size), size);
 		m >> v.length;
 		return m;
 	}
 };
 
-int edist(ATGC_bitmap bitmap1, ATGC_bitmap bitmap2)
+int edist(const ATGC_bitmap & bitmap1, const ATGC_bitmap & bitmap2)
 {
 	int rows = bitmap1.length + 1;
 	int cols = bitmap2.length + 1;
@@ -553,6 +745,94 @@ int edist(ATGC_bitmap bitmap1, ATGC_bitmap bitmap2)
 	return result;
 }
 
+//====================================
+//thresholded edit distance by Myers' bit-vector algorithm (Hyyro's block form, as in edlib):
+//"pattern" is cut into 64-row blocks, and "text" gives one column per base
+//a block keeps the vertical deltas of its rows (+1 in Pv, -1 in Mv) and the value of its last row
+//only the blocks of the band |i - j| <= max_dist are computed, as a path of cost <= max_dist stays in it,
+//and the cells above and below the band are overestimated (+1 steps), which never lowers a cell inside
+//the search stops once no cell of a column can reach the end at a total cost <= max_dist
+
+//internal use only! one column of a block, returns the horizontal delta out of its last row
+inline int myers_block(u64 & Pv, u64 & Mv, u64 Eq, int hin, u64 last_bit)
+{
+	u64 Xv = Eq | Mv;
+	if(hin < 0) Eq |= 1;
+	u64 Xh = (((Eq & Pv) + Pv) ^ Pv) | Eq;
+	u64 Ph = Mv | ~(Xh | Pv);
+	u64 Mh = Pv & Xh;
+	int hout = (Ph & last_bit) ? 1 : ((Mh & last_bit) ? -1 : 0);
+	Ph <<= 1;
+	Mh <<= 1;
+	if(hin < 0) Mh |= 1;
+	else if(hin > 0) Ph |= 1;
+	Pv = Mh | ~(Xv | Ph);
+	Mv = Ph & Xv;
+	return hout;
+}
+
+//the edit distance of "pattern" and "text" if it is <= max_dist, otherwise max_dist + 1
+int edist_within(const ATGC_view & pattern, const ATGC_view & text, int max_dist)
+{
+	int m = pattern.length;
+	int n = text.length;
+	if(m - n > max_dist || n - m > max_dist) return max_dist + 1;
+	if(m == 0 || n == 0) return (m > n) ? m : n;
+	//------
+	int blocks = (m + 63) / 64;
+	vector<u64> peq(4 * blocks, 0); //peq[base * blocks + b]: rows of block b with this base
+	for(int i = 0; i < m; i++)
+		peq[pattern.get(i) * blocks + i / 64] |= 1ull << (i % 64);
+	vector<u64> Pv(blocks, ~0ull), Mv(blocks, 0);
+	vector<int> score(blocks); //value of the last row of each block
+	for(int b = 0; b < blocks; b++)
+		score[b] = (b + 1) * 64 < m ? (b + 1) * 64 : m;
+	u64 last_bit = 1ull << ((m - 1) % 64); //last row of the last block
+	//------
+	int first = 0; //first block of the band
+	int last = (max_dist < m ? max_dist : m - 1) / 64; //last block of the band
+	for(int j = 1; j <= n; j++)
+	{
+		int base = text.get(j - 1);
+		int top = j - max_dist; //rows [top, bottom] of the band, 1-based
+		int bottom = j + max_dist < m ? j + max_dist : m;
+		while(last < (bottom - 1) / 64)
+		{
+			last++; //a new block continues the one above with +1 steps
+			Pv[last] = ~0ull;
+			Mv[last] = 0;
+			score[last] = score[last - 1] + ((last + 1) * 64 < m ? 64 : m - last * 64);
+		}
+		if(top > 1 && (top - 1) / 64 > first)
+			first = (top - 1) / 64;
+		int hin = 1; //the row above the band grows by 1 per column
+		for(int b = first; b <= last; b++)
+		{
+			hin = myers_block(Pv[b], Mv[b], peq[base * blocks + b], hin, (b == blocks - 1) ? last_bit : (1ull << 63));
+			score[b] += hin;
+		}
+		//------
+		//a lower bound of the final distance through column j, one per block as in edlib:
+		//a row of block b is at least score[b] minus the rows of the block, as a vertical step is at most 1,
+		//and the rest of "pattern" and "text" then needs at least |(m - i) - (n - j)| edits, 0 at row "diag"
+		int best = max_dist + 1;
+		if(top <= 0)
+			best = j + ((m - (n - j) > 0) ? m - (n - j) : (n - j) - m); //row 0
+		int diag = m - n + j;
+		for(int b = first; b <= last; b++)
+		{
+			int lo = b * 64 + 1; //rows [lo, hi] of the block, 1-based
+			int hi = (b + 1) * 64 < m ? (b + 1) * 64 : m;
+			int value = score[b] - (hi - lo + 1);
+			if(diag < lo) value += lo - diag;
+			else if(diag > hi) value += diag - hi;
+			if(value < best) best = value;
+		}
+		if(best > max_dist) return max_dist + 1;
+	}
+	return (score[blocks - 1] <= max_dist) ? score[blocks - 1] : max_dist + 1;
+}
+
 //=======================================
 
 class Contig
@@ -592,34 +872,67 @@ public:
 		seq.length = atoi(pch);
 		pch=strtok(NULL, " ");
 		int size = atoi(pch);
+		vector<u8> bytes(size);
 		for(int i = 0 ; i < size; i++)
 		{
 			pch=strtok(NULL, " ");
-			seq.seq.push_back((u8)atoi(pch));
+			bytes[i] = (u8)atoi(pch);
 		}
+		seq.set_bytes(bytes.empty() ? NULL : &bytes[0], size);
+	}
+
+	void parse(obinstream& m)
+	{
+		m >> id;
+		m >> in_neighbor;
+		m >> in_pol;
+		m >> in_count;
+		m >> out_neighbor;
+		m >> out_pol;
+		m >> out_count;
+		m >> freq;
+		m >> seq;
+	}
+
+	void dumpTo(RecordWriter* writer) //pol and count are written as 0 for a NULL_MER neighbor, as in the text format
+	{
+		writer->check();
+		ibinstream & m = writer->m;
+		bool has_in = (in_neighbor != NULL_MER);
+		bool has_out = (out_neighbor != NULL_MER);
+		m << id;
+		m << in_neighbor;
+		m << (has_in && in_pol);
+		m << (has_in ? in_count : 0u);
+		m << out_neighbor;
+		m << (has_out && out_pol);
+		m << (has_out ? out_count : 0u);
+		m << freq;
+		m << seq;
+		writer->end_record();
 	}
 
 	void dumpTo(BufferedWriter* writer)
 	{
 		char buf[100];
 		writer->check();
-		sprintf(buf, "%llu\t", id);
+		sprintf(buf, KMER_FMT "\t", id);
 		writer->write(buf);
 		//------
-		if(in_neighbor == NULL_MER) sprintf(buf, "%llu 0 0", in_neighbor);
-		else sprintf(buf, "%llu %d %u", in_neighbor, (in_pol ? 1 : 0), in_count);
+		if(in_neighbor == NULL_MER) sprintf(buf, KMER_FMT " 0 0", in_neighbor);
+		else sprintf(buf, KMER_FMT " %d %u", in_neighbor, (in_pol ? 1 : 0), in_count);
 		writer->write(buf);
 		//------
-		if(out_neighbor == NULL_MER) sprintf(buf, " %llu 0 0", out_neighbor);
-		else sprintf(buf, " %llu %d %u", out_neighbor, (out_pol ? 1 : 0), out_count);
+		if(out_neighbor == NULL_MER) sprintf(buf, " " KMER_FMT " 0 0", out_neighbor);
+		else sprintf(buf, " " KMER_FMT " %d %u", out_neighbor, (out_pol ? 1 : 0), out_count);
 		writer->write(buf);
 		//------
-		sprintf(buf, " %u %u %u", freq, seq.length, seq.seq.size());
+		sprintf(buf, " %u %u %u", freq, seq.length, seq.num_bytes());
 		writer->write(buf);
 		//------
-		for(int i=0; i<seq.seq.size(); i++)
+		for(int i=0; i<seq.num_bytes(); i++)
 		{
-			sprintf(buf, " %u", seq.seq[i]);
+			sprintf(buf, " %u", seq.get_byte(i));
 			writer->write(buf);
 		}
 		writer->write("\n");
@@ -703,6 +1016,16 @@ obinstream & operator>>(obinstream & m, ContigNB & v)
 	return m;
 }
 
+//record types of the binary stage format
+static const int REC_DBG_VERTEX = 1; //DeBruijn -> ListRank/SV: id, bitmap, freqs
+static const int REC_KMER_LINK = 2; //ListRank/SV -> ContigMerge: id, pred, (nb_bitmap, count) list
+static const int REC_AMBI_VERTEX = 3; //ListRank/SV -> AmbiConnect: id, (nb_bitmap, count) list
+static const int REC_CONTIG = 4; //ContigMerge/BubbleFilter -> BubbleFilter/AmbiConnect/AmbiMerge: Contig
+static const int REC_AMBI_CONNECT = 5; //AmbiConnect -> TipRemoval: id, ambi_nbs, contig_nbs
+static const int REC_NOTIP = 6; //TipRemoval -> AmbListRank/AmbiSV: id, type, ambi_nbs, contig_nbs
+static const int REC_AMBI_LINK = 7; //AmbListRank/AmbiSV -> AmbiMerge: id, pred, type, ambi_nbs, contig_nbs
+static const int REC_KPLUS_STORE = 8; //DeBruijn -> DeBruijn_FromStore: min_count, num, (id delta, count) vints
+
 //v-type:
 static const u8 V_1 =  1;
 static const u8 V1_1 = 2;
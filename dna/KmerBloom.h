@@ -0,0 +1,77 @@
+#ifndef KMERBLOOM_H
+#define KMERBLOOM_H
+
+#include <vector>
+#include "GlobalDna.h"
+#include "KmerTable.h"
+using namespace std;
+
+//====================================
+//Bloom filter over k_mer ids, partitioned by owning worker
+//part w occupies words[w * part_words, (w + 1) * part_words), so the parts can be exchanged as fixed-size blocks
+//bits are set with atomic OR, so parser threads may share one filter
+class KmerBloom
+{
+public:
+	static const int NUM_HASHES = 3;
+
+	vector<u64> words;
+	u64 part_words;
+	u64 part_bits;
+	int num_parts;
+
+	KmerBloom()
+	{
+		part_words = 0;
+		part_bits = 0;
+		num_parts = 0;
+	}
+
+	void init(u64 bits_per_part, int parts)
+	{
+		part_words = (bits_per_part + 63) >> 6;
+		if(part_words == 0)
+			part_words = 1;
+		part_bits = part_words << 6;
+		num_parts = parts;
+		vector<u64>(part_words * parts, 0).swap(words);
+	}
+
+	void clear() //releases the memory
+	{
+		vector<u64>().swap(words);
+	}
+
+	//the i-th bit position of "id" in part "part", by double hashing
+	inline u64 position(int part, u64 h, int i)
+	{
+		u64 h1 = h & 0xFFFFFFFF;
+		u64 h2 = (h >> 32) | 1;
+		return part * part_bits + (h1 + i * h2) % part_bits;
+	}
+
+	//sets the bit at "pos", returns its old value
+	inline bool set_bit(u64 pos)
+	{
+		u64 mask = 1ull << (pos & 63);
+		return __sync_fetch_and_or(&words[pos >> 6], mask) & mask;
+	}
+
+	inline bool get_bit(u64 pos)
+	{
+		return (words[pos >> 6] >> (pos & 63)) & 1ull;
+	}
+
+	bool contains(int part, k_mer id)
+	{
+		u64 h = kmer_mix(id);
+		for(int i = 0; i < NUM_HASHES; i++)
+		{
+			if(!get_bit(position(part, h, i)))
+				return false;
+		}
+		return true;
+	}
+};
+
+#endif
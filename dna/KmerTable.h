@@ -0,0 +1,131 @@
+#ifndef KMERTABLE_H
+#define KMERTABLE_H
+
+#include <vector>
+#include <algorithm>
+#include "GlobalDna.h"
+using namespace std;
+
+//bit mixer (murmur3 finalizer) for table positions
+//it must differ from DefaultHash: all keys held by one worker have the same "id % _num_workers"
+//the key is widened to 64 bits, so the shifts and products are the same for KMER_BITS = 32
+inline u64 kmer_mix(u64 key)
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdull;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ull;
+	key ^= key >> 33;
+	return key;
+}
+
+//====================================
+//open-addressing hash table (linear probing) keyed by k_mer
+//entries are stored inline in one array, there is no per-entry allocation
+//T must have a field "k_mer id" and a function "bool empty()",
+//and a default-constructed T must be empty (it marks a free slot)
+template <class T>
+class KmerTable
+{
+public:
+	vector<T> slots;
+	size_t num; //number of occupied slots
+	size_t mask; //slots.size() - 1
+
+	KmerTable(size_t capacity = 1024)
+	{
+		init(capacity);
+	}
+
+	void init(size_t capacity) //capacity is rounded up to a power of 2
+	{
+		size_t cap = 16;
+		while(cap < capacity) cap <<= 1;
+		vector<T>(cap).swap(slots);
+		num = 0;
+		mask = cap - 1;
+	}
+
+	inline size_t size()
+	{
+		return num;
+	}
+
+	inline size_t capacity()
+	{
+		return slots.size();
+	}
+
+	inline bool used(size_t pos)
+	{
+		return !slots[pos].empty();
+	}
+
+	//returns the entry of "id"
+	//if "id" is new, a default (empty) entry with its id set is returned,
+	//the caller must make it non-empty before the next call
+	T & get(k_mer id)
+	{
+		if((num + 1) * 10 > slots.size() * 7) grow(); //load factor <= 0.7
+		size_t pos = kmer_mix(id) & mask;
+		while(!slots[pos].empty())
+		{
+			if(slots[pos].id == id) return slots[pos];
+			pos = (pos + 1) & mask;
+		}
+		num++;
+		slots[pos].id = id;
+		return slots[pos];
+	}
+
+	T * find(k_mer id)
+	{
+		if(slots.empty()) return NULL;
+		size_t pos = kmer_mix(id) & mask;
+		while(!slots[pos].empty())
+		{
+			if(slots[pos].id == id) return &slots[pos];
+			pos = (pos + 1) & mask;
+		}
+		return NULL;
+	}
+
+	void reset() //empties the table, keeping its memory
+	{
+		fill(slots.begin(), slots.end(), T());
+		num = 0;
+	}
+
+	void clear() //releases the memory
+	{
+		vector<T>().swap(slots);
+		num = 0;
+		mask = 0;
+	}
+
+	void swap(KmerTable & other)
+	{
+		slots.swap(other.slots);
+		std::swap(num, other.num);
+		std::swap(mask, other.mask);
+	}
+
+private:
+	void grow()
+	{
+		vector<T> old;
+		old.swap(slots);
+		size_t cap = old.empty() ? 16 : (old.size() << 1);
+		vector<T>(cap).swap(slots);
+		mask = cap - 1;
+		for(size_t i = 0; i < old.size(); i++)
+		{
+			if(old[i].empty()) continue;
+			size_t pos = kmer_mix(old[i].id) & mask;
+			while(!slots[pos].empty()) pos = (pos + 1) & mask;
+			slots[pos] = old[i];
+		}
+	}
+};
+
+#endif
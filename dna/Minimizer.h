@@ -0,0 +1,72 @@
+#ifndef MINIMIZER_H
+#define MINIMIZER_H
+
+#include "basic/Vertex.h"
+#include "GlobalDna.h"
+#include "KmerTable.h"
+using namespace std;
+
+//====================================
+//minimizer partitioning: a k mer is placed by its minimizer, the m-mer with the smallest order,
+//so consecutive k mers of a unitig, which share most of their m-mers, mostly live on the same worker
+//m-mers are compared in canonical form, so a k mer and its reverse complement have the same minimizer
+//the order is kmer_mix() of the canonical m-mer, as lexicographic order would pile poly-A onto one worker
+//m is DnaContext::minimizer_len, 0 = minimizer partitioning is off (DefaultHash)
+
+inline u64 mmer_order(k_mer fwd, k_mer rc)
+{
+	return kmer_mix((fwd < rc) ? fwd : rc);
+}
+
+//smallest order of the "m"-mers of a sequence of "len" bases (a k mer or a k+1 mer)
+u64 min_mmer_order(k_mer seq, int len, int m)
+{
+	k_mer rc = 0, s = seq;
+	for(int i = 0; i < len; i++)
+	{
+		rc = (rc << 2) | ((s & 3ull) ^ 3ull);
+		s >>= 2;
+	}
+	k_mer mmask = ((k_mer)-1) >> (8 * sizeof(k_mer) - 2 * m);
+	u64 best = (u64)-1;
+	int last = len - m;
+	for(int i = 0; i <= last; i++)
+	{
+		//the m-mer at offset i from the right of seq is at offset (last - i) from the right of rc
+		u64 order = mmer_order((seq >> (2 * i)) & mmask, (rc >> (2 * (last - i))) & mmask);
+		if(order < best)
+			best = order;
+	}
+	return best;
+}
+
+inline int minimizer_owner(u64 order)
+{
+	return order % _num_workers;
+}
+
+//owner of a k+1 mer: the owner of the smaller minimizer of its two k mers
+inline int kplus_owner(k_mer id, const DnaContext & dna)
+{
+	return minimizer_owner(min_mmer_order(id, dna.mer_length + 1, dna.minimizer_len));
+}
+
+//HashT for vertices keyed by k mer ids
+//keys that are not k mers (e.g., contig ids with the top bit set) fall back to DefaultHash
+template <class KeyT>
+class MinimizerHash
+{
+public:
+	inline int operator()(KeyT key)
+	{
+		const DnaContext & dna = stage_dna();
+		if(dna.minimizer_len == 0 || key > dna.kick)
+			return fallback(key);
+		return minimizer_owner(min_mmer_order(key, dna.mer_length, dna.minimizer_len));
+	}
+
+private:
+	DefaultHash<KeyT> fallback;
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include "utils/type.h"
 #include "basic/DNAPregel-dev.h"
 #include "GlobalDna.h"
+#include "Minimizer.h"
 
 using namespace std;
 
@@ -51,61 +52,36 @@ int bitCount(u32 n)
 	return ((tmp + (tmp >>3)) & 030707070707) % 63;
 }
 
-class SVVertex: public Vertex<k_mer, SVValue, k_mer>
+class SVVertex: public Vertex<k_mer, SVValue, k_mer, MinimizerHash<k_mer> >
 {
 
 public:
 	inline k_mer is_contig_end(k_mer s) //return type treated as bool
 	{
-		return s >> (mer_length*2);
+		return s >> (stage_dna().mer_length*2);
 	}
 
-	void get_neighbors(vector<k_mer> & collector)
+	//neighbors to add to a collector of "size" entries: up to "bound" entries, and at least one more (if any)
+	inline int neighbor_room(size_t size)
 	{
 		int bound = value().type; //for type = 1 or 2
 		if(value().type == 3) bound = bitCount(value().bitmap);
-		//------
-		for(int j = 0; j < 4; j ++)
-		{
-			int shift = getShift(v1_pol[j], v2_pol[j]);
-			u32 shifted = (value().bitmap >> shift);
-			//in-neighbors
-			for(int i=0; i<8; i++)
-			{
-				if (shifted & ATGC_bits[i])
-				{
-					k_mer nb_id = get_neighbor(id, ATGC_bits[i], v1_pol[j], v2_pol[j]);
-					collector.push_back(nb_id);
-					if(collector.size() >= bound) return; //return earlier
-				}
-			}
-		}
+		int room = bound - (int)size;
+		return (room > 1) ? room : 1;
+	}
+
+	void get_neighbors(vector<k_mer> & collector)
+	{
+		k_mer nbs[32];
+		int num = enum_neighbors(id, value().bitmap, nbs, neighbor_room(collector.size()), stage_dna());
+		collector.insert(collector.end(), nbs, nbs + num);
 	}
 
 	void get_neighbor_infos(vector<neighbor_info> & collector)
 	{
-		int bound = value().type; //for type = 1 or 2
-		if(value().type == 3) bound = bitCount(value().bitmap);
-		//------
-		for(int j = 0; j < 4; j++)
-		{
-			int shift = getShift(v1_pol[j], v2_pol[j]);
-			u32 shifted = (value().bitmap >> shift);
-			//in-neighbors
-			for(int i=0; i<8; i++)
-			{
-				if (shifted & ATGC_bits[i])
-				{
-					neighbor_info nb;
-					nb.set_ATGC(bit2ATGC[i]);
-					nb.set_in(i < 4);
-					nb.set_left(v1_pol[j]);
-					nb.set_right(v2_pol[j]);
-					collector.push_back(nb);
-					if(collector.size() >= bound) return; //return earlier
-				}
-			}
-		}
+		neighbor_info nbs[32];
+		int num = enum_neighbor_infos(value().bitmap, nbs, neighbor_room(collector.size()));
+		collector.insert(collector.end(), nbs, nbs + num);
 	}
 
 	void set_neighbors(MessageContainer & msgs) //assume ambiguous vertices have broadcasted msgs
@@ -113,7 +89,7 @@ public:
 		//ambiguous vertices vote to halt; //unambiguous vertices set "preds" properly
 		if(value().type == 1)
 		{
-			k_mer self = (id | END_MER);
+			k_mer self = (id | stage_dna().end_mer);
 			value().neighbors.push_back(self); //one pred is itself
 			//another is the only neighbor
 			if(msgs.size() == 1) value().neighbors.push_back(self);
@@ -128,13 +104,13 @@ public:
 		{
 			if(msgs.size() == 2) //itself is a contig
 			{
-				k_mer self = (id | END_MER);
+				k_mer self = (id | stage_dna().end_mer);
 				value().neighbors.push_back(self);
 				value().neighbors.push_back(self);
 			}
 			else if(msgs.size() == 1)
 			{
-				k_mer self = (id | END_MER);
+				k_mer self = (id | stage_dna().end_mer);
 				value().neighbors.push_back(self);
 				//find the other neighbor
 				vector<k_mer> nbs;
@@ -412,13 +388,14 @@ public:
 class SVWorker:public Worker<SVVertex, SVAgg>
 {
 	char buf[100];
+	DnaContext dna;
 
 public:
 
-	SVWorker(int k)
+	SVWorker(int k, int minimizer_len)
 	{
-		set_mer_length(k);
-		END_MER = 1ull << (2*mer_length);
+		dna.init(k, minimizer_len);
+		set_stage_dna(dna);
 	}
 
 	virtual SVVertex* toVertex(char* line)
@@ -443,6 +420,70 @@ public:
 		return v;
 	}
 
+	virtual SVVertex* toVertex(obinstream& m, int type) //REC_DBG_VERTEX
+	{
+		check_type(type, REC_DBG_VERTEX, "a De Bruijn graph");
+		SVVertex* v=new SVVertex;
+		m >> v->id;
+		m >> v->value().bitmap;
+		m >> v->value().freqs;
+		v->value().type = get_type(v->value().bitmap);
+		v->value().prev_D = v->id;
+		v->value().D = v->id;
+		return v;
+	}
+
+	virtual int record_type(int output)
+	{
+		return (output == 0) ? REC_KMER_LINK : REC_AMBI_VERTEX;
+	}
+
+	virtual void torecord(SVVertex* v, vector<RecordWriter *> & writers)
+	{
+		//same fields as toline(), without the text
+		SVValue & val = v->value();
+		vector<neighbor_info> nb_infos;
+		v->get_neighbor_infos(nb_infos);
+		vector<u32> counts;
+		parse_vints(counts, val.freqs);
+		if(val.type == 3)
+		{
+			vector<k_mer> nbs;
+			v->get_neighbors(nbs);
+			hash_map<k_mer, int> nb_pos;
+			for(int i = 0; i < nbs.size(); i++ )
+			{
+				nb_pos[nbs[i]] = i;
+			}
+			//------
+			RecordWriter & writer = *writers[1];
+			writer.check();
+			writer.m << v->id;
+			writer.m << (u32)val.neighbors.size();
+			for(int i = 0; i < val.neighbors.size(); i++)
+			{
+				int pos = nb_pos[val.neighbors[i]]; //get pos of ambi-nb
+				writer.m << nb_infos[pos].bitmap;
+				writer.m << counts[pos];
+			}
+			writer.end_record();
+		}
+		else
+		{
+			RecordWriter & writer = *writers[0];
+			writer.check();
+			writer.m << v->id;
+			writer.m << v->value().D;
+			writer.m << (u8)counts.size();
+			for(int i=0; i<counts.size(); i++)
+			{
+				writer.m << nb_infos[i].bitmap;
+				writer.m << counts[i];
+			}
+			writer.end_record();
+		}
+	}
+
 	virtual void toline(SVVertex* v, vector<BufferedWriter *> & writers)
 	{
 		//if type = 3, output to amb_out: vid \t num_nbs nb1 freq1 (nb2 freq2) ... //only ambi-neighbors
@@ -450,9 +491,9 @@ public:
 		SVValue & val = v->value();
 		if(val.type == 3)
 		{
-			sprintf(buf, "%llu\t", v->id);
-//			convert(v->id, buf, mer_length);  // human read
-//			buf[mer_length] = '\0';
+			sprintf(buf, KMER_FMT "\t", v->id);
+//			convert(v->id, buf, stage_dna().mer_length);  // human read
+//			buf[stage_dna().mer_length] = '\0';
 			writers[1]->write(buf);
 			//------
 			//build ID -> pos map
@@ -487,7 +528,7 @@ public:
 			vector<u32> counts;
 			parse_vints(counts, val.freqs);
 			//----
-			sprintf(buf, "%llu\t%llu %u", v->id, v->value().D, counts.size());
+			sprintf(buf, KMER_FMT "\t" KMER_FMT " %u", v->id, v->value().D, counts.size());
 			writers[0]->write(buf);
 			for(int i=0; i<counts.size(); i++)
 			{
@@ -499,7 +540,7 @@ public:
 	}
 };
 
-void SV(string in_path, string unamb_path, string amb_path, int length)
+void SV(string in_path, string unamb_path, string amb_path, int length, int minimizer_len = 0)
 {
 	MultiOutputParams param;
 	param.input_path=in_path;
@@ -508,7 +549,7 @@ void SV(string in_path, string unamb_path, string amb_path, int length)
 	param.force_write=true;
 	param.native_dispatcher=false;
 	//	init_workers();
-	SVWorker worker(length);
+	SVWorker worker(length, minimizer_len);
 	SVAgg agg = SVAgg();
 	worker.setAggregator(&agg);
 	worker.run(param);
@@ -4,11 +4,10 @@
 #include "utils/type.h"
 #include "basic/DNAPregel-dev.h"
 #include "GlobalDna.h"
+#include "Minimizer.h"
 
 using namespace std;
 
-static int tipLen_threshold;
-
 //=================================
 
 //v-status:
@@ -69,7 +68,7 @@ obinstream & operator>>(obinstream & m,  TRMsg & v)
 
 //=================================
 
-class TRVertex: public Vertex<k_mer, TRVertexValue, TRMsg>
+class TRVertex: public Vertex<k_mer, TRVertexValue, TRMsg, MinimizerHash<k_mer> >
 {
 public:
 	int getType()
@@ -119,7 +118,7 @@ public:
 		for(int i = 0; i < value().ambi_nbs.size(); i++)
 		{
 			AmbiNB & cur = value().ambi_nbs[i];
-			k_mer target = get_neighbor(id, cur.nb_info);
+			k_mer target = get_neighbor(id, cur.nb_info, stage_dna());
 			if(msg_src != target)
 			{
 				TRMsg msg;
@@ -153,7 +152,7 @@ public:
 		for(int i = 0; i < value().ambi_nbs.size(); i++)
 		{
 			AmbiNB & cur = value().ambi_nbs[i];
-			k_mer target = get_neighbor(id, cur.nb_info);
+			k_mer target = get_neighbor(id, cur.nb_info, stage_dna());
 			if( msg_src != target)
 			{
 				TRMsg msg;
@@ -194,7 +193,7 @@ public:
 		vector<AmbiNB>::iterator it;
 		for(it = value().ambi_nbs.begin(); it != value().ambi_nbs.end(); it++)
 		{
-			k_mer target = get_neighbor(id, it->nb_info);
+			k_mer target = get_neighbor(id, it->nb_info, stage_dna());
 			if(target == nb)
 			{
 				value().ambi_nbs.erase(it);
@@ -222,7 +221,7 @@ public:
 				int result = forward_length();
 				if(result != -1)
 				{
-					if(result <= tipLen_threshold)
+					if(result <= stage_dna().tip_threshold)
 						value().status = Deleted;
 					else
 						value().status = Finished;
@@ -250,7 +249,7 @@ public:
 					return;
 				}
 				//V1 - {V1-1} - V1
-				if(messages[0].length + 1 <= tipLen_threshold)
+				if(messages[0].length + 1 <= stage_dna().tip_threshold)
 				{
 					value().status = Deleted;
 					respond(messages[0].source, Deleted);
@@ -275,7 +274,7 @@ public:
 						int result = forward_length(messages[i].length, messages[i].source);
 						if(result != -1)
 						{
-							if(result <= tipLen_threshold)
+							if(result <= stage_dna().tip_threshold)
 							{
 								value().status = Deleted;
 								forward_status(Deleted, NULL_MER);
@@ -293,7 +292,7 @@ public:
 			{
 				for(int i = 0; i < messages.size(); i++)
 				{
-					if(messages[i].length + 1 <= tipLen_threshold)
+					if(messages[i].length + 1 <= stage_dna().tip_threshold)
 					{
 						respond(messages[i].source, Deleted);
 						delete_edge(messages[i].source);
@@ -309,13 +308,15 @@ public:
 class TRWorker:public Worker<TRVertex>
 {
 	char buf[1024];
+	DnaContext dna;
 
 public:
 
-	TRWorker(int k, int tip_len)
+	TRWorker(int k, int tip_len, int minimizer_len)
 	{
-		set_mer_length(k);
-		tipLen_threshold = k - 1 + tip_len;
+		dna.init(k, minimizer_len);
+		dna.tip_threshold = k - 1 + tip_len;
+		set_stage_dna(dna);
 	}
 
 	virtual TRVertex* toVertex(char* line)
@@ -355,13 +356,44 @@ public:
 		return v;
 	}
 
+	virtual TRVertex* toVertex(obinstream& m, int type) //REC_AMBI_CONNECT
+	{
+		check_type(type, REC_AMBI_CONNECT, "an AmbiConnect output");
+		TRVertex* v=new TRVertex;
+		m >> v->id;
+		m >> v->value().ambi_nbs;
+		m >> v->value().contig_nbs;
+		v->value().type = v->getType();
+		v->value().status = Normal;
+		return v;
+	}
+
+	virtual int record_type(int output)
+	{
+		return REC_NOTIP;
+	}
+
+	virtual void torecord(TRVertex* v, RecordWriter& writer)
+	{
+		TRVertexValue & value = v->value();
+		if(value.status != Deleted)
+		{
+			writer.check();
+			writer.m << v->id;
+			writer.m << value.type;
+			writer.m << value.ambi_nbs;
+			writer.m << value.contig_nbs;
+			writer.end_record();
+		}
+	}
+
 	virtual void toline(TRVertex* v, BufferedWriter& writer)
 	{
 		TRVertexValue & value = v->value();
 		if(value.status != Deleted)
 		{
 			int size = value.ambi_nbs.size();
-			sprintf(buf, "%llu\t%u %d", v->id, value.type, size);
+			sprintf(buf, KMER_FMT "\t%u %d", v->id, value.type, size);
 			writer.write(buf);
 			//------
 			for(int i = 0; i < size; i++)
@@ -377,7 +409,7 @@ public:
 			for(int i = 0; i < size; i++)
 			{
 				ContigNB & nb = value.contig_nbs[i];
-				sprintf(buf, " %llu %u %llu %d", nb.nid, nb.ninfo.bitmap, nb.contigID, nb.length);
+				sprintf(buf, " " KMER_FMT " %u " KMER_FMT " %d", nb.nid, nb.ninfo.bitmap, nb.contigID, nb.length);
 				writer.write(buf);
 			}
 			writer.write("\n");
@@ -405,7 +437,7 @@ public:
 	}
 };
 
-void TipRemoval(string amb_path, string out_path, int mer_len, int tip_len)
+void TipRemoval(string amb_path, string out_path, int mer_len, int tip_len, int minimizer_len = 0)
 {
 	WorkerParams param;
 	param.input_path = amb_path;
@@ -413,7 +445,7 @@ void TipRemoval(string amb_path, string out_path, int mer_len, int tip_len)
 	param.force_write=true;
 	param.native_dispatcher=false;
 //	init_workers();
-	TRWorker worker(mer_len, tip_len);
+	TRWorker worker(mer_len, tip_len, minimizer_len);
 	worker.runPhase(param);
 //	worker_finalize();
 }
@@ -20,6 +20,12 @@ int freq_t;
 int bubble_t;
 int tip_t;
 int output_contig_t;
+int output_line_width = 0;
+int output_gzip = 0;
+DeBruijnOptions dbg_options; //De Bruijn graph options of the ini, k_mer_t and freq_t are set in main()
+int use_kplus_store = 0;
+int minimizer_t = 0;
+int in_memory_stages = 0;
 
 string HDFS_INPUT_PATH;
 string DeBruijn_PATH;
@@ -63,6 +69,36 @@ void load_system_parameters()
 	if(val!=val_not_found) tip_t=val;
 	val = iniparser_getint(ini, "PPA_Assembler:output_contig_t", val_not_found);
 	if(val!=val_not_found) output_contig_t=val;
+	val = iniparser_getint(ini, "PPA_Assembler:output_line_width", val_not_found);
+	if(val!=val_not_found) output_line_width=val;
+	val = iniparser_getint(ini, "PPA_Assembler:output_gzip", val_not_found);
+	if(val!=val_not_found) output_gzip=val;
+	val = iniparser_getint(ini, "PPA_Assembler:num_threads", val_not_found);
+	if(val!=val_not_found) dbg_options.num_threads=val;
+	val = iniparser_getint(ini, "PPA_Assembler:mem_budget_mb", val_not_found);
+	if(val!=val_not_found) dbg_options.mem_budget_mb=val;
+	val = iniparser_getint(ini, "PPA_Assembler:bloom_mb", val_not_found);
+	if(val!=val_not_found) dbg_options.bloom_mb=val;
+	val = iniparser_getint(ini, "PPA_Assembler:stream_cache_mb", val_not_found);
+	if(val!=val_not_found) dbg_options.stream_cache_mb=val;
+	val = iniparser_getint(ini, "PPA_Assembler:dedup_reads", val_not_found);
+	if(val!=val_not_found) dbg_options.dedup_reads = (val != 0);
+	val = iniparser_getint(ini, "PPA_Assembler:normalize_c", val_not_found);
+	if(val!=val_not_found) dbg_options.normalize_c=val;
+	val = iniparser_getint(ini, "PPA_Assembler:normalize_mb", val_not_found);
+	if(val!=val_not_found) dbg_options.normalize_mb=val;
+	val = iniparser_getint(ini, "PPA_Assembler:correct_mb", val_not_found);
+	if(val!=val_not_found) dbg_options.correct_mb=val;
+	val = iniparser_getint(ini, "PPA_Assembler:use_kplus_store", val_not_found);
+	if(val!=val_not_found) use_kplus_store=val;
+	val = iniparser_getint(ini, "PPA_Assembler:minimizer_t", val_not_found);
+	if(val!=val_not_found) minimizer_t=val;
+	val = iniparser_getint(ini, "PPA_Assembler:text_stage_format", val_not_found);
+	if(val!=val_not_found) binary_stage_io = (val == 0);
+	val = iniparser_getint(ini, "PPA_Assembler:in_memory_stages", val_not_found);
+	if(val!=val_not_found) in_memory_stages=val;
+	val = iniparser_getint(ini, "PPA_Assembler:dump_stages", val_not_found);
+	if(val!=val_not_found) stage_hdfs_copy = (val != 0);
 
 	str = iniparser_getstring(ini,"PPA_Assembler:HDFS_INPUT_PATH", str_not_found);
 	if(strcmp(str, str_not_found)!=0) HDFS_INPUT_PATH = str;
@@ -84,59 +120,102 @@ void load_system_parameters()
 	if(strcmp(str, str_not_found)!=0) AmbLink_PATH = str;
 	str = iniparser_getstring(ini,"PPA_Assembler:HDFS_OUTPUT_PATH", str_not_found);
 	if(strcmp(str, str_not_found)!=0) HDFS_OUTPUT_PATH = str;
+	str = iniparser_getstring(ini,"PPA_Assembler:KPlusStore_PATH", str_not_found);
+	if(strcmp(str, str_not_found)!=0) dbg_options.store_path = str;
+	str = iniparser_getstring(ini,"PPA_Assembler:BaseKPlusStore_PATH", str_not_found);
+	if(strcmp(str, str_not_found)!=0) dbg_options.base_store_path = str;
 
 	iniparser_freedict(ini);
 }
 
+//in-memory pipeline: each stage hands its records to the next stage on the same rank
+void keep_stages_in_memory()
+{
+	if(!binary_stage_io)
+	{
+		fprintf(stderr, "in_memory_stages requires the binary stage format (text_stage_format = 0)!\n");
+		exit(-1);
+	}
+	keep_stage_in_memory(DeBruijn_PATH);
+	keep_stage_in_memory(KmerLink_PATH);
+	keep_stage_in_memory(AmbVtx_PATH);
+	keep_stage_in_memory(NoBubble_PATH);
+	keep_stage_in_memory(Contig_PATH);
+	keep_stage_in_memory(AmbConnect_PATH);
+	keep_stage_in_memory(NoTip_PATH);
+	keep_stage_in_memory(AmbLink_PATH);
+}
+
 int main(int argc, char** argv)
 {
 	init_workers();
 	load_system_parameters();
+	if(in_memory_stages) keep_stages_in_memory();
 
 	//sample
-	DeBruijn_Build(HDFS_INPUT_PATH, DeBruijn_PATH, k_mer_t, freq_t);  //freq threshold
+	dbg_options.k_mer_t = k_mer_t;
+	dbg_options.minimizer_t = minimizer_t;
+	dbg_options.freq_t = freq_t;  //freq threshold
+	if(use_kplus_store)
+		DeBruijn_FromStore(DeBruijn_PATH, dbg_options);  //the reads are not read again
+	else
+		DeBruijn_Build(HDFS_INPUT_PATH, DeBruijn_PATH, dbg_options);
 	worker_barrier();
 
 #ifdef SV_USED
-	SV(DeBruijn_PATH, KmerLink_PATH, AmbVtx_PATH, k_mer_t);
+	SV(DeBruijn_PATH, KmerLink_PATH, AmbVtx_PATH, k_mer_t, minimizer_t);
 	worker_barrier();
+	release_stage(DeBruijn_PATH);
 
 	Contig_Merge(KmerLink_PATH, NoBubble_PATH, k_mer_t);
 	worker_barrier();
+	release_stage(KmerLink_PATH);
 
 	Bubble_Filter(NoBubble_PATH,  Contig_PATH, k_mer_t, bubble_t);  //editDistance
 	worker_barrier();
+	release_stage(NoBubble_PATH);
 
-	AmbiConnect(AmbVtx_PATH, Contig_PATH,AmbConnect_PATH, k_mer_t, tip_t);  //tip's sequence length
+	AmbiConnect(AmbVtx_PATH, Contig_PATH,AmbConnect_PATH, k_mer_t, tip_t, minimizer_t);  //tip's sequence length
 	worker_barrier();
+	release_stage(AmbVtx_PATH);
 
-	TipRemoval(AmbConnect_PATH, NoTip_PATH, k_mer_t, tip_t);  //tip's sequence length
+	TipRemoval(AmbConnect_PATH, NoTip_PATH, k_mer_t, tip_t, minimizer_t);  //tip's sequence length
 	worker_barrier();
+	release_stage(AmbConnect_PATH);
 
-	AmbiSV(NoTip_PATH, AmbLink_PATH, k_mer_t);
+	AmbiSV(NoTip_PATH, AmbLink_PATH, k_mer_t, minimizer_t);
 	worker_barrier();
+	release_stage(NoTip_PATH);
 
 #else
-	ListRank(DeBruijn_PATH, KmerLink_PATH, AmbVtx_PATH, k_mer_t);
+	ListRank(DeBruijn_PATH, KmerLink_PATH, AmbVtx_PATH, k_mer_t, minimizer_t);
 	worker_barrier();
+	release_stage(DeBruijn_PATH);
 
 	Contig_Merge(KmerLink_PATH, NoBubble_PATH, k_mer_t);
 	worker_barrier();
+	release_stage(KmerLink_PATH);
 
 	Bubble_Filter(NoBubble_PATH,  Contig_PATH, k_mer_t, bubble_t);  //editDistance
 	worker_barrier();
+	release_stage(NoBubble_PATH);
 
-	AmbiConnect(AmbVtx_PATH, Contig_PATH,AmbConnect_PATH, k_mer_t, tip_t);  //tip's sequence length
+	AmbiConnect(AmbVtx_PATH, Contig_PATH,AmbConnect_PATH, k_mer_t, tip_t, minimizer_t);  //tip's sequence length
 	worker_barrier();
+	release_stage(AmbVtx_PATH);
 
-	TipRemoval(AmbConnect_PATH, NoTip_PATH, k_mer_t, tip_t);  //tip's sequence length
+	TipRemoval(AmbConnect_PATH, NoTip_PATH, k_mer_t, tip_t, minimizer_t);  //tip's sequence length
 	worker_barrier();
+	release_stage(AmbConnect_PATH);
 
-	AmbListRank(NoTip_PATH, AmbLink_PATH, k_mer_t);
+	AmbListRank(NoTip_PATH, AmbLink_PATH, k_mer_t, minimizer_t);
 	worker_barrier();
+	release_stage(NoTip_PATH);
 
 #endif
-	AmbiMerge(Contig_PATH, AmbLink_PATH, HDFS_OUTPUT_PATH, k_mer_t, output_contig_t);
+	AmbiMerge(Contig_PATH, AmbLink_PATH, HDFS_OUTPUT_PATH, k_mer_t, output_contig_t, output_line_width, output_gzip);
+	release_stage(Contig_PATH);
+	release_stage(AmbLink_PATH);
 
 	worker_finalize();
 	return 0;
@@ -1,9 +1,44 @@
 #include "utils/hdfs_core.h"
+#include "utils/put_reads.h"
 
+//put INPUT OUTPUT: a fastq file -> one read per line
+//put [-p] [-n PARTS] [-t THREADS] INPUT... OUTPUT: read files or directories (FASTQ/FASTA, may be gzipped)
+//   -p: 2-bit packed reads instead of one read per line
+//   -n: exactly PARTS part files of about the same size (e.g., the number of workers)
+//   -t: THREADS files are read at the same time
 int main(int argc, char** argv)
 {
-	const char* input = argv[1];  	//input path on local, a fastq file
-	const char* output = argv[2]; 	//output path on HDFS, as input of PPA-Assembler
-	putFASTQ(input, output);
+	bool packed = false;
+	int num_parts = 0;
+	int num_threads = 1;
+	int i = 1;
+	for (; i < argc && argv[i][0] == '-'; i++)
+	{
+		if (strcmp(argv[i], "-p") == 0)
+			packed = true;
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			num_parts = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			num_threads = atoi(argv[++i]);
+		else
+		{
+			fprintf(stderr, "Unknown option %s!\n", argv[i]);
+			return -1;
+		}
+	}
+	if (argc - i < 2)
+	{
+		fprintf(stderr, "Usage: put [-p] [-n PARTS] [-t THREADS] INPUT... OUTPUT\n");
+		return -1;
+	}
+	if (i == 1 && argc == 3)
+	{
+		const char* input = argv[1];  	//input path on local, a fastq file
+		const char* output = argv[2]; 	//output path on HDFS, as input of PPA-Assembler
+		putFASTQ(input, output);
+		return 0;
+	}
+	vector<string> inputs(argv + i, argv + argc - 1); //input paths on local
+	putReads(inputs, argv[argc - 1], packed, num_parts, num_threads); //output path on HDFS, as input of PPA-Assembler
 	return 0;
 }
@@ -0,0 +1,50 @@
+#include "test_util.h"
+
+//time of edist_within() and of the full edist() it replaced in Bubble_Filter, per pair of sequences,
+//on pairs with max_dist / 2 + 1 edits (within the threshold) and on unrelated pairs (early exit)
+
+int main(int argc, char** argv)
+{
+	mt19937_64 rng(1);
+	int lengths[] = { 100, 1000, 10000 };
+	int dists[] = { 2, 20, 200 };
+	vector<int> a, b, c;
+	for(int l = 0; l < 3; l++)
+	{
+		int length = lengths[l];
+		random_bases(rng, a, length);
+		random_bases(rng, c, length);
+		ATGC_bitmap pattern, unrelated;
+		to_bitmap(a, pattern);
+		to_bitmap(c, unrelated);
+		int reps = 1000000 / length + 1;
+		int edist_reps = 10000000 / length / length + 1; //edist() is quadratic
+		//------
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		long long sum = 0;
+		for(int r = 0; r < edist_reps; r++)
+			sum += edist(pattern, unrelated);
+		printf("length %5d: edist %.1f us\n", length, elapsed_us(start) / edist_reps);
+		for(int d = 0; d < 3; d++)
+		{
+			int max_dist = dists[d];
+			b = a;
+			mutate_bases(rng, b, max_dist / 2 + 1);
+			ATGC_bitmap text;
+			to_bitmap(b, text);
+			start = chrono::steady_clock::now();
+			for(int r = 0; r < reps; r++)
+				sum += edist_within(pattern.view(), text.view(), max_dist);
+			double similar_us = elapsed_us(start) / reps;
+			start = chrono::steady_clock::now();
+			for(int r = 0; r < reps; r++)
+				sum += edist_within(pattern.view(), unrelated.view(), max_dist);
+			double unrelated_us = elapsed_us(start) / reps;
+			printf("length %5d, max_dist %3d: edist_within %.2f us (similar), %.2f us (unrelated)\n",
+					length, max_dist, similar_us, unrelated_us);
+		}
+		if(sum == 0)
+			printf("\n"); //keeps the calls from being optimized out
+	}
+	return 0;
+}
@@ -0,0 +1,37 @@
+#include "test_util.h"
+
+//time of getRC() and of the loop it replaced, per k mer, for a few k
+
+int main(int argc, char** argv)
+{
+	const int NUM_IDS = 1 << 20;
+	const int REPS = 20;
+	mt19937_64 rng(1);
+	int ks[] = { 15, 21, 31 };
+	for(int t = 0; t < 3; t++)
+	{
+		int k = ks[t];
+		if(k > MAX_MER_LENGTH)
+			continue;
+		DnaContext dna;
+		dna.init(k);
+		vector<k_mer> ids(NUM_IDS);
+		for(int i = 0; i < NUM_IDS; i++)
+			ids[i] = random_kmer(rng, k);
+		k_mer sum_loop = 0, sum_rc = 0; //keeps the calls from being optimized out
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for(int r = 0; r < REPS; r++)
+			for(int i = 0; i < NUM_IDS; i++)
+				sum_loop += getRC_loop(ids[i], k);
+		double loop_us = elapsed_us(start);
+		start = chrono::steady_clock::now();
+		for(int r = 0; r < REPS; r++)
+			for(int i = 0; i < NUM_IDS; i++)
+				sum_rc += getRC(ids[i], dna);
+		double rc_us = elapsed_us(start);
+		double n = (double)NUM_IDS * REPS;
+		printf("k = %d: loop %.2f ns, getRC %.2f ns, %.1fx%s\n", k, 1000 * loop_us / n, 1000 * rc_us / n,
+				loop_us / rc_us, (sum_loop == sum_rc) ? "" : " (RESULTS DIFFER)");
+	}
+	return 0;
+}
@@ -0,0 +1,303 @@
+#include "test_util.h"
+
+//checks the optimized DNA primitives against their reference versions, returns 1 on any mismatch
+
+int num_failed = 0;
+
+//getRC() against the loop, for every k of this build: all k mers up to EXHAUSTIVE_K, random ones above
+const int EXHAUSTIVE_K = 10;
+
+void test_getRC(mt19937_64 & rng)
+{
+	for(int k = 1; k <= MAX_MER_LENGTH; k++)
+	{
+		DnaContext dna;
+		dna.init(k);
+		bool all = (k <= EXHAUSTIVE_K);
+		long long num = all ? (1LL << (2 * k)) : 1000000;
+		int bad = 0;
+		for(long long i = 0; i < num; i++)
+		{
+			k_mer id = all ? (k_mer)i : random_kmer(rng, k);
+			if(getRC(id, dna) != getRC_loop(id, k))
+			{
+				if(bad == 0)
+					printf("getRC mismatch: k = %d, id = " KMER_FMT "\n", k, id);
+				bad++;
+			}
+		}
+		if(bad > 0)
+			num_failed++;
+	}
+	printf("getRC: k = 1 to %d checked (all k mers up to k = %d)\n", MAX_MER_LENGTH, EXHAUSTIVE_K);
+}
+
+//neighbor_of() (through both get_neighbor() and enum_neighbors()) and edge_info against the old if-chain, for every k
+//of this build: every edge bit of every k mer up to NEIGHBOR_EXHAUSTIVE_K, of random ones above; then the order and the
+//"max" cut of enum_neighbors() and enum_neighbor_infos() on every bitmap within one 16-bit half, and on random ones
+const int NEIGHBOR_EXHAUSTIVE_K = 6;
+
+void check_neighbor_bits(k_mer id, const DnaContext & dna, int & bad)
+{
+	int k = dna.mer_length;
+	for(int j = 0; j < 4; j++)
+	{
+		for(int i = 0; i < 8; i++)
+		{
+			int b = getShift(ref_v1_pol[j], ref_v2_pol[j]) + __builtin_ctz(ATGC_bits[i]);
+			k_mer expected = get_neighbor_ifchain(id, ATGC_bits[i], ref_v1_pol[j], ref_v2_pol[j], k);
+			neighbor_info nb;
+			enum_neighbor_infos_loop(1u << b, &nb, 1);
+			k_mer out[1];
+			int num = enum_neighbors(id, 1u << b, out, 1, dna);
+			neighbor_info from_table;
+			from_table.bitmap = edge_info[b];
+			if(get_neighbor(id, ATGC_bits[i], ref_v1_pol[j], ref_v2_pol[j], dna) != expected
+					|| neighbor_of(id, getRC(id, dna), edge_info[b], dna) != expected
+					|| num != 1 || out[0] != expected
+					|| edge_info[b] != nb.bitmap
+					|| get_neighbor(id, from_table, dna) != get_neighbor_info_ifchain(id, nb, k))
+			{
+				if(bad == 0)
+					printf("neighbor mismatch: k = %d, id = " KMER_FMT ", bit %d\n", k, id, b);
+				bad++;
+			}
+		}
+	}
+}
+
+void check_enum_neighbors(k_mer id, u32 bitmap, int max, const DnaContext & dna, int & bad)
+{
+	k_mer got[32], expected[32];
+	neighbor_info got_nb[32], expected_nb[32];
+	int num = enum_neighbors(id, bitmap, got, max, dna);
+	int num_nb = enum_neighbor_infos(bitmap, got_nb, max);
+	int expected_num = enum_neighbors_loop(id, bitmap, expected, max, dna.mer_length);
+	bool same = (num == expected_num && enum_neighbor_infos_loop(bitmap, expected_nb, max) == expected_num
+			&& num_nb == expected_num);
+	for(int i = 0; same && i < num; i++)
+		same = (got[i] == expected[i] && got_nb[i].bitmap == expected_nb[i].bitmap);
+	if(!same)
+	{
+		if(bad == 0)
+			printf("enum_neighbors mismatch: k = %d, id = " KMER_FMT ", bitmap = %08x, max = %d\n",
+					dna.mer_length, id, bitmap, max);
+		bad++;
+	}
+}
+
+void test_neighbors(mt19937_64 & rng)
+{
+	int bad = 0;
+	for(int k = 1; k <= MAX_MER_LENGTH; k++)
+	{
+		DnaContext dna;
+		dna.init(k);
+		bool all = (k <= NEIGHBOR_EXHAUSTIVE_K);
+		long long num = all ? (1LL << (2 * k)) : 10000;
+		for(long long i = 0; i < num; i++)
+			check_neighbor_bits(all ? (k_mer)i : random_kmer(rng, k), dna, bad);
+		k_mer id = random_kmer(rng, k);
+		if(k == 1 || k == NEIGHBOR_EXHAUSTIVE_K || k == MAX_MER_LENGTH)
+		{
+			for(u32 x = 0; x < (1u << 16); x++)
+			{
+				check_enum_neighbors(id, x, 1 + x % 17, dna, bad); //in the low half: HH and HL
+				check_enum_neighbors(id, x << 16, 1 + x % 17, dna, bad); //in the high half: LH and LL
+			}
+		}
+		for(int i = 0; i < 10000; i++)
+			check_enum_neighbors(id, (u32)rng(), 1 + rng() % 33, dna, bad);
+	}
+	if(bad > 0)
+		num_failed++;
+	printf("neighbors: k = 1 to %d checked (all k mers up to k = %d), %d mismatches\n", MAX_MER_LENGTH,
+			NEIGHBOR_EXHAUSTIVE_K, bad);
+}
+
+//edist_within() against edist(), "text" in both orientations
+void check_edist(const vector<int> & a, const vector<int> & b, int max_dist, int & bad)
+{
+	ATGC_bitmap pattern, text;
+	to_bitmap(a, pattern);
+	to_bitmap(b, text);
+	for(int rc = 0; rc < 2; rc++)
+	{
+		int full = rc ? edist(pattern, text.get_reverse()) : edist(pattern, text);
+		int expected = (full <= max_dist) ? full : max_dist + 1;
+		int got = edist_within(pattern.view(), text.view(rc), max_dist);
+		if(got != expected)
+		{
+			if(bad == 0)
+				printf("edist_within mismatch: m = %d, n = %d, max_dist = %d, rc = %d: %d instead of %d\n",
+						(int)a.size(), (int)b.size(), max_dist, rc, got, expected);
+			bad++;
+		}
+	}
+}
+
+void test_edist_within(mt19937_64 & rng)
+{
+	int bad = 0;
+	int cases = 0;
+	vector<int> a, b;
+	for(int i = 0; i < 20000; i++)
+	{
+		int length = (i % 10 == 0) ? rng() % 400 : rng() % 150; //some over several 64-row blocks
+		random_bases(rng, a, length);
+		if(i % 5 == 0)
+			random_bases(rng, b, rng() % 150); //unrelated
+		else
+		{
+			b = a;
+			mutate_bases(rng, b, (i % 13 == 0) ? rng() % 80 : rng() % 6);
+		}
+		int max_dist = (i % 11 == 0) ? rng() % 100 : rng() % 6;
+		check_edist(a, b, max_dist, bad);
+		cases += 2;
+	}
+	if(bad > 0)
+		num_failed++;
+	printf("edist_within: %d cases, %d mismatches\n", cases, bad);
+}
+
+//ATGC_bitmap against a vector of its bases: get(), views with or without rc and skip(), append() of a view at
+//every offset within a word, get_reverse(), and the serialized bytes against those of the old byte array
+bool same_bases(const ATGC_bitmap & bitmap, const vector<int> & bases)
+{
+	if(bitmap.length != (int)bases.size() || bitmap.words.size() != (bases.size() + 31) / 32)
+		return false;
+	for(size_t i = 0; i < bases.size(); i++)
+		if(bitmap.get(i) != (k_mer)bases[i])
+			return false;
+	int tail = 2 * (bitmap.length & 31);
+	return tail == 0 || (bitmap.words.back() << tail) == 0; //append_bits() ORs into the bits after the last base
+}
+
+bool same_bases(const ATGC_view & view, const vector<int> & bases, int from)
+{
+	if(view.length != (int)bases.size() - from)
+		return false;
+	for(int i = 0; i < view.length; i++)
+		if(view.get(i) != (k_mer)bases[from + i])
+			return false;
+	return true;
+}
+
+void check_bitmap(mt19937_64 & rng, const vector<int> & bases, int & bad)
+{
+	int length = bases.size();
+	ATGC_bitmap bitmap;
+	to_bitmap(bases, bitmap);
+	vector<int> rev(length);
+	for(int i = 0; i < length; i++)
+		rev[i] = bases[length - 1 - i] ^ 3;
+	bool ok = same_bases(bitmap, bases) && same_bases(bitmap.get_reverse(), rev);
+	//------
+	int skips[] = { 0, 1, (int)(rng() % 40), (int)(rng() % (length + 1)), length, length + 1 };
+	for(int s = 0; s < 6; s++)
+	{
+		int n = (skips[s] < length) ? skips[s] : length;
+		for(int rc = 0; rc < 2; rc++)
+		{
+			const vector<int> & expected = rc ? rev : bases;
+			ATGC_view view = bitmap.view(rc).skip(skips[s]);
+			ok = ok && same_bases(view, expected, n);
+			for(int t = 0; t < 4 && view.length > 0; t++)
+			{
+				int pos = rng() % view.length;
+				int num = 1 + rng() % ((view.length - pos < 32) ? view.length - pos : 32);
+				u64 bits = 0;
+				for(int i = 0; i < num; i++)
+					bits |= (u64)expected[n + pos + i] << (62 - 2 * i);
+				ok = ok && view.bits(pos, num) == bits;
+			}
+			vector<int> prefix;
+			random_bases(rng, prefix, rng() % 70); //the view is appended at every offset within a word
+			ATGC_bitmap joined;
+			to_bitmap(prefix, joined);
+			joined.append(view);
+			prefix.insert(prefix.end(), expected.begin() + n, expected.end());
+			ok = ok && same_bases(joined, prefix);
+			joined.append(1); //per-base append after a bulk one
+			prefix.push_back(1);
+			ok = ok && same_bases(joined, prefix);
+		}
+	}
+	//------
+	vector<u8> seq;
+	to_old_bytes(bases, seq);
+	ibinstream m, old_m;
+	m << bitmap;
+	old_m << seq;
+	old_m << length;
+	ok = ok && m.size() == old_m.size() && memcmp(m.get_buf(), old_m.get_buf(), m.size()) == 0;
+	char* buf = new char[m.size()];
+	memcpy(buf, m.get_buf(), m.size());
+	obinstream um(buf, m.size());
+	ATGC_bitmap loaded;
+	um >> loaded;
+	ok = ok && same_bases(loaded, bases);
+	loaded.append(2); //the bytes past the last base must be 0 after loading
+	vector<int> longer = bases;
+	longer.push_back(2);
+	ok = ok && same_bases(loaded, longer);
+	if(!ok)
+	{
+		if(bad == 0)
+			printf("ATGC_bitmap mismatch: length = %d\n", length);
+		bad++;
+	}
+}
+
+void test_ATGC_bitmap(mt19937_64 & rng)
+{
+	int bad = 0;
+	int cases = 0;
+	vector<int> bases;
+	for(int i = 0; i < 3000; i++)
+	{
+		int length = (i < 200) ? i : rng() % 1000; //every length up to a few words
+		random_bases(rng, bases, length);
+		check_bitmap(rng, bases, bad);
+		cases++;
+	}
+	//init() against the bases of the k mer
+	for(int k = 1; k <= MAX_MER_LENGTH; k++)
+	{
+		DnaContext dna;
+		dna.init(k);
+		k_mer id = random_kmer(rng, k);
+		ATGC_bitmap bitmap;
+		bitmap.init(id, dna);
+		bases.resize(k);
+		for(int i = 0; i < k; i++)
+			bases[i] = (id >> (2 * (k - 1 - i))) & 3;
+		if(!same_bases(bitmap, bases))
+		{
+			if(bad == 0)
+				printf("ATGC_bitmap init mismatch: k = %d, id = " KMER_FMT "\n", k, id);
+			bad++;
+		}
+		cases++;
+	}
+	if(bad > 0)
+		num_failed++;
+	printf("ATGC_bitmap: %d cases, %d mismatches\n", cases, bad);
+}
+
+int main(int argc, char** argv)
+{
+	mt19937_64 rng(2024);
+	test_getRC(rng);
+	test_neighbors(rng);
+	test_ATGC_bitmap(rng);
+	test_edist_within(rng);
+	if(num_failed > 0)
+	{
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("OK\n");
+	return 0;
+}
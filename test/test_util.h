@@ -0,0 +1,203 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include "utils/type.h"
+#include "basic/DNAPregel-dev.h"
+#include "dna/GlobalDna.h"
+#include <chrono>
+#include <random>
+
+using namespace std;
+
+//shared by the tests and the benchmarks: reference versions of optimized functions, and random sequences
+
+//getRC() before it was made O(1): one base per iteration
+k_mer getRC_loop(k_mer id, int mer_length)
+{
+	k_mer rc = 0;
+	for(int i = 0; i < mer_length; i++)
+	{
+		k_mer tag = id & 3ull; //last 2 bits
+		tag ^= 3ull; //complement
+		rc |= tag; //append to rc
+		id >>= 2; //next 2 bits
+		if(i != mer_length - 1) rc <<= 2;
+	}
+	return rc;
+}
+
+//get_neighbor() before neighbor_of(): an if-chain over the 8 edge bits, with the loop getRC()
+k_mer get_neighbor_ifchain(k_mer id, u8 bit, bool v1_pol, bool v2_pol, int mer_length)
+{
+	k_mer kick = 0xFFFFFFFFFFFFFFFF >> (64 - 2 * mer_length);
+	k_mer neighborID = id;
+	//------
+	if (bit == inA)
+	{
+		if(v2_pol) neighborID = getRC_loop(id, mer_length);
+		neighborID >>= 2;
+		if(v1_pol) neighborID = getRC_loop(neighborID, mer_length);
+	}
+	else if (bit == inT)
+	{
+		if(v2_pol) neighborID = getRC_loop(id, mer_length);
+		neighborID >>= 2;
+		neighborID |= (T << (2 * mer_length - 2));
+		if(v1_pol) neighborID = getRC_loop(neighborID, mer_length);
+	}
+	else if (bit == inG)
+	{
+		if(v2_pol) neighborID = getRC_loop(id, mer_length);
+		neighborID >>= 2;
+		neighborID |= (G << (2 * mer_length - 2));
+		if(v1_pol) neighborID = getRC_loop(neighborID, mer_length);
+	}
+	else if (bit == inC)
+	{
+		if(v2_pol) neighborID = getRC_loop(id, mer_length);
+		neighborID >>= 2;
+		neighborID |= (C << (2 * mer_length - 2));
+		if(v1_pol) neighborID = getRC_loop(neighborID, mer_length);
+	}
+	else if (bit == outA)
+	{
+		if(v1_pol) neighborID = getRC_loop(id, mer_length);
+		neighborID <<= 2;
+		neighborID &= kick; //kick out highest two bits
+		if(v2_pol) neighborID = getRC_loop(neighborID, mer_length);
+	}
+	else if (bit == outT)
+	{
+		if(v1_pol) neighborID = getRC_loop(id, mer_length);
+		neighborID <<= 2;
+		neighborID &= kick;
+		neighborID |= T;
+		if(v2_pol) neighborID = getRC_loop(neighborID, mer_length);
+	}
+	else if (bit == outG)
+	{
+		if(v1_pol) neighborID = getRC_loop(id, mer_length);
+		neighborID <<= 2;
+		neighborID &= kick;
+		neighborID |= G;
+		if(v2_pol) neighborID = getRC_loop(neighborID, mer_length);
+	}
+	else if (bit == outC)
+	{
+		if(v1_pol) neighborID = getRC_loop(id, mer_length);
+		neighborID <<= 2;
+		neighborID &= kick;
+		neighborID |= C;
+		if(v2_pol) neighborID = getRC_loop(neighborID, mer_length);
+	}
+	return neighborID;
+}
+
+//get_neighbor(me, nb) before neighbor_of()
+k_mer get_neighbor_info_ifchain(k_mer me, neighbor_info nb, int mer_length)
+{
+	k_mer tag = nb.get_ATGC();
+	tag = bit_pos[tag];
+	if(nb.is_in()) tag <<= 4;
+	return get_neighbor_ifchain(me, tag, nb.left_isH(), nb.right_isH(), mer_length);
+}
+
+//(v1_pol, v2_pol) of the loops of get_neighbors() and get_neighbor_infos() in ListRank before enum_neighbors()
+static const bool ref_v1_pol[4] = {false, false, true, true};
+static const bool ref_v2_pol[4] = {false, true, false, true};
+
+//get_neighbors() of ListRank before enum_neighbors(), "max" is its bound on the neighbors collected
+int enum_neighbors_loop(k_mer id, u32 bitmap, k_mer* out, int max, int mer_length)
+{
+	int num = 0;
+	for(int j = 0; j < 4; j ++)
+	{
+		int shift = getShift(ref_v1_pol[j], ref_v2_pol[j]);
+		u32 shifted = (bitmap >> shift);
+		for(int i=0; i<8; i++)
+		{
+			if (shifted & ATGC_bits[i])
+			{
+				out[num++] = get_neighbor_ifchain(id, ATGC_bits[i], ref_v1_pol[j], ref_v2_pol[j], mer_length);
+				if(num >= max) return num; //return earlier
+			}
+		}
+	}
+	return num;
+}
+
+//get_neighbor_infos() of ListRank before enum_neighbor_infos()
+int enum_neighbor_infos_loop(u32 bitmap, neighbor_info* out, int max)
+{
+	int num = 0;
+	for(int j = 0; j < 4; j++)
+	{
+		int shift = getShift(ref_v1_pol[j], ref_v2_pol[j]);
+		u32 shifted = (bitmap >> shift);
+		for(int i=0; i<8; i++)
+		{
+			if (shifted & ATGC_bits[i])
+			{
+				neighbor_info nb;
+				nb.set_ATGC(bit2ATGC[i]);
+				nb.set_in(i < 4);
+				nb.set_left(ref_v1_pol[j]);
+				nb.set_right(ref_v2_pol[j]);
+				out[num++] = nb;
+				if(num >= max) return num; //return earlier
+			}
+		}
+	}
+	return num;
+}
+
+//a random k mer of "mer_length" bases
+k_mer random_kmer(mt19937_64 & rng, int mer_length)
+{
+	return (k_mer)(rng() & (0xFFFFFFFFFFFFFFFFull >> (64 - 2 * mer_length)));
+}
+
+void random_bases(mt19937_64 & rng, vector<int> & bases, int length)
+{
+	bases.resize(length);
+	for(int i = 0; i < length; i++)
+		bases[i] = rng() % 4;
+}
+
+//applies "edits" random substitutions, insertions and deletions to "bases"
+void mutate_bases(mt19937_64 & rng, vector<int> & bases, int edits)
+{
+	for(int e = 0; e < edits; e++)
+	{
+		int op = rng() % 3;
+		int pos = bases.empty() ? 0 : rng() % bases.size();
+		if(op == 0 && !bases.empty())
+			bases[pos] = (bases[pos] + 1 + rng() % 3) % 4;
+		else if(op == 1)
+			bases.insert(bases.begin() + pos, (int)(rng() % 4));
+		else if(!bases.empty())
+			bases.erase(bases.begin() + pos);
+	}
+}
+
+void to_bitmap(const vector<int> & bases, ATGC_bitmap & bitmap)
+{
+	bitmap = ATGC_bitmap();
+	for(size_t i = 0; i < bases.size(); i++)
+		bitmap.append(bases[i]);
+}
+
+//the bytes of ATGC_bitmap before its words: 4 bases per byte, the first one in the highest bits
+void to_old_bytes(const vector<int> & bases, vector<u8> & seq)
+{
+	seq.assign((bases.size() + 3) / 4, 0);
+	for(size_t i = 0; i < bases.size(); i++)
+		seq[i / 4] |= (u8)(bases[i] << (6 - 2 * (i % 4)));
+}
+
+double elapsed_us(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+}
+
+#endif
@@ -4,6 +4,7 @@
 #define COMMUNICATION_H
 
 #include "mpi.h"
+#include <climits>
 #include "time.h"
 #include "serialization.h"
 #include "global.h"
@@ -31,6 +32,13 @@ long long all_sum_LL(long long my_copy)
 	return tmp;
 }
 
+long long all_max_LL(long long my_copy)
+{
+	long long tmp = 0;
+	MPI_Allreduce(&my_copy, &tmp, 1, MPI_LONG_LONG_INT, MPI_MAX, MPI_COMM_WORLD);
+	return tmp;
+}
+
 char all_bor(char my_copy)
 {
 	char tmp;
@@ -95,6 +103,108 @@ T recv_data(int src)
 	return data;
 }
 
+//============================================
+//streaming send/recv: a worker sends batches to any worker while it keeps computing,
+//and polls for the batches sent to it
+//a batch of 0 bytes ends the stream of its sender (MPI keeps the order of messages between two workers)
+//the tag differs from the one of pregel_send, so a stream never mixes with the synchronous exchanges
+#define STREAM_TAG 1
+
+class StreamChannel
+{
+public:
+	struct PendingSend
+	{
+		MPI_Request req;
+		ibinstream* m;
+	};
+
+	vector<PendingSend> pending; //sends not known to be completed
+	size_t max_pending;
+	int num_ended; //workers whose stream has ended
+
+	StreamChannel(size_t max_pending_sends)
+		: max_pending(max_pending_sends)
+		, num_ended(0)
+	{
+	}
+
+	~StreamChannel()
+	{
+		for(size_t i = 0; i < pending.size(); i++)
+		{
+			MPI_Wait(&pending[i].req, MPI_STATUS_IGNORE);
+			delete pending[i].m;
+		}
+	}
+
+	//takes over "m", which must be kept until the send completes
+	void send(ibinstream* m, int dst)
+	{
+		PendingSend ps;
+		ps.m = m;
+		MPI_Isend(m->size() ? m->get_buf() : NULL, m->size(), MPI_CHAR, dst, STREAM_TAG, MPI_COMM_WORLD, &ps.req);
+		pending.push_back(ps);
+	}
+
+	//true if no more batch should be sent before the receiver polls,
+	//as waiting for a send without receiving could deadlock two workers sending to each other
+	bool full()
+	{
+		size_t kept = 0;
+		for(size_t i = 0; i < pending.size(); i++)
+		{
+			int done;
+			MPI_Test(&pending[i].req, &done, MPI_STATUS_IGNORE);
+			if(done)
+				delete pending[i].m;
+			else
+				pending[kept++] = pending[i];
+		}
+		pending.resize(kept);
+		return pending.size() >= max_pending;
+	}
+
+	//returns a batch that has arrived (the caller deletes it), or NULL if none
+	//end markers are consumed here
+	obinstream* try_recv()
+	{
+		while(true)
+		{
+			int ready;
+			MPI_Status status;
+			MPI_Iprobe(MPI_ANY_SOURCE, STREAM_TAG, MPI_COMM_WORLD, &ready, &status);
+			if(!ready)
+				return NULL;
+			int size;
+			MPI_Get_count(&status, MPI_CHAR, &size);
+			char* buf = new char[size > 0 ? size : 1]; //obinstream will delete it
+			MPI_Recv(buf, size, MPI_CHAR, status.MPI_SOURCE, STREAM_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+			if(size > 0)
+				return new obinstream(buf, size);
+			delete[] buf;
+			num_ended++;
+		}
+	}
+
+	//sends the end marker to all other workers
+	void end_stream()
+	{
+		for(int i = 0; i < _num_workers; i++)
+		{
+			if(i != _my_rank)
+				send(new ibinstream, i);
+		}
+	}
+
+	//true once all other workers ended their streams and all sends completed
+	bool done()
+	{
+		full();
+		return num_ended == _num_workers - 1 && pending.empty();
+	}
+};
+
 //============================================
 //all-to-all
 template <class T>
@@ -394,6 +504,44 @@ void all_to_all(vector<T>& to_send, vector<T1>& to_get)
 	StopTimer(COMMUNICATION_TIMER);
 }
 
+//"num" words as the count of an MPI call, which is an int
+int mpi_count(unsigned long long num)
+{
+	if (num > INT_MAX)
+	{
+		fprintf(stderr, "%llu words exceed the INT_MAX count of an MPI call!\n", num);
+		exit(-1);
+	}
+	return (int)num;
+}
+
+//fixed-size blocks of words: block i of "to_send" goes to worker i, block i of "to_get" comes from worker i
+void all_to_all_words(unsigned long long* to_send, unsigned long long block_words, unsigned long long* to_get)
+{
+	int count = mpi_count(block_words);
+	StartTimer(COMMUNICATION_TIMER);
+	MPI_Alltoall(to_send, count, MPI_UNSIGNED_LONG_LONG, to_get, count, MPI_UNSIGNED_LONG_LONG, MPI_COMM_WORLD);
+	StopTimer(COMMUNICATION_TIMER);
+}
+
+//element-wise sum of "buf" over all workers, in place
+void all_sum_words(unsigned int* buf, unsigned long long num)
+{
+	int count = mpi_count(num);
+	StartTimer(COMMUNICATION_TIMER);
+	MPI_Allreduce(MPI_IN_PLACE, buf, count, MPI_UNSIGNED, MPI_SUM, MPI_COMM_WORLD);
+	StopTimer(COMMUNICATION_TIMER);
+}
+
+//every worker contributes a block of "block_words" words, block i of "to_get" comes from worker i
+void all_gather_words(unsigned long long* to_send, unsigned long long block_words, unsigned long long* to_get)
+{
+	int count = mpi_count(block_words);
+	StartTimer(COMMUNICATION_TIMER);
+	MPI_Allgather(to_send, count, MPI_UNSIGNED_LONG_LONG, to_get, count, MPI_UNSIGNED_LONG_LONG, MPI_COMM_WORLD);
+	StopTimer(COMMUNICATION_TIMER);
+}
+
 //============================================
 //scatter
 template <class T>
@@ -0,0 +1,187 @@
+#ifndef FASTA_WRITER_H
+#define FASTA_WRITER_H
+
+#include "hdfs_core.h"
+
+using namespace std;
+
+//====== FastaWriter ======
+//writes sequences given as 2-bit bases in 64-bit words (A = 0, C = 1, G = 2, T = 3, the first base in the highest bits,
+//as ATGC_bitmap and the packed read format) as FASTA records, in part files part_<me>_<n> like BufferedWriter
+//each byte of bases is decoded to 4 characters by one table lookup, straight into the output buffer,
+//and a sequence is written in chunks of FASTA_CHUNK_BASES, so it may be of any length
+//line_width > 0: the sequence is wrapped every "line_width" bases, 0: on a single line
+//gzip_level > 0: each part file is a gzip file (part_<me>_<n>.gz) compressed at this level (1 to 9)
+//a new part file is started once the current one reaches HDFS_BLOCK_SIZE bytes, between two records
+
+const int FASTA_CHUNK_BASES = 65536;
+
+struct FastaWriter
+{
+	hdfsFS fs;
+	const char* path;
+	int me;
+	int line_width;
+	int gzip_level;
+	int nxtPart;
+	hdfsFile curHdl;
+	size_t curSize; //bytes written to the current file
+	vector<char> buf;
+	unsigned int quad[256]; //byte of 4 bases -> their 4 characters, in memory order
+	//gzip fields, zs is NULL without gzip
+	z_stream* zs;
+	vector<char> zbuf;
+
+	FastaWriter(const char* path, hdfsFS fs, int me, int line_width = 0, int gzip_level = 0)
+		: nxtPart(0)
+		, curSize(0)
+	{
+		this->path = path;
+		this->fs = fs;
+		this->me = me;
+		this->line_width = line_width;
+		this->gzip_level = gzip_level;
+		static const char bases[4] = { 'A', 'C', 'G', 'T' };
+		for (int i = 0; i < 256; i++)
+		{
+			char chars[4] = { bases[i >> 6], bases[(i >> 4) & 3], bases[(i >> 2) & 3], bases[i & 3] };
+			memcpy(&quad[i], chars, 4);
+		}
+		zs = NULL;
+		if (gzip_level > 0)
+		{
+			zs = new z_stream;
+			zbuf.resize(HDFS_BUF_SIZE);
+		}
+		buf.reserve(2 * HDFS_BUF_SIZE);
+		nextHdl();
+	}
+
+	~FastaWriter()
+	{
+		closeHdl();
+		delete zs;
+	}
+
+	//internal use only!
+	void write_raw(const void* bytes, size_t size)
+	{
+		if (size == 0)
+			return;
+		tSize numWritten = hdfsWrite(fs, curHdl, bytes, size);
+		if (numWritten == -1)
+		{
+			fprintf(stderr, "Failed to write file!\n");
+			exit(-1);
+		}
+		curSize += size;
+	}
+
+	//internal use only! passes "buf" to the file, through deflate() with gzip
+	void flush_buf(int zflush = Z_NO_FLUSH)
+	{
+		if (zs == NULL)
+		{
+			if (!buf.empty())
+				write_raw(&buf[0], buf.size());
+			buf.clear();
+			return;
+		}
+		zs->next_in = (Bytef*)(buf.empty() ? NULL : &buf[0]);
+		zs->avail_in = buf.size();
+		int ret;
+		do
+		{
+			zs->next_out = (Bytef*)&zbuf[0];
+			zs->avail_out = zbuf.size();
+			ret = deflate(zs, zflush);
+			if (ret == Z_STREAM_ERROR)
+			{
+				fprintf(stderr, "Failed to compress %s!\n", path);
+				exit(-1);
+			}
+			write_raw(&zbuf[0], zbuf.size() - zs->avail_out);
+		} while (zs->avail_out == 0 || (zflush == Z_FINISH && ret != Z_STREAM_END));
+		buf.clear();
+	}
+
+	//internal use only!
+	void closeHdl()
+	{
+		flush_buf(zs != NULL ? Z_FINISH : Z_NO_FLUSH);
+		if (zs != NULL)
+			deflateEnd(zs);
+		if (hdfsFlush(fs, curHdl))
+		{
+			fprintf(stderr, "Failed to 'flush' %s\n", path);
+			exit(-1);
+		}
+		hdfsCloseFile(fs, curHdl);
+	}
+
+	//internal use only!
+	void nextHdl()
+	{
+		if (nxtPart > 0)
+			closeHdl();
+		char fname[30];
+		sprintf(fname, "part_%d_%d%s", me, nxtPart, (zs != NULL) ? ".gz" : "");
+		nxtPart++;
+		char* filePath = new char[strlen(path) + strlen(fname) + 2];
+		sprintf(filePath, "%s/%s", path, fname);
+		curHdl = getWHandle(filePath, fs);
+		delete[] filePath;
+		curSize = 0;
+		if (zs != NULL)
+		{
+			memset(zs, 0, sizeof(z_stream));
+			if (deflateInit2(zs, gzip_level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) //15 + 16: zlib window, gzip header
+			{
+				fprintf(stderr, "Failed to initialize gzip compression!\n");
+				exit(-1);
+			}
+		}
+	}
+
+	//internal use only! decodes bases [pos, pos + n) of "words" to the end of "buf"
+	void put_bases(const unsigned long long* words, long long pos, int n)
+	{
+		size_t start = buf.size();
+		buf.resize(start + n + 3); //the last lookup may write 3 characters too many
+		char* out = &buf[start];
+		long long end = pos + n;
+		for (; pos < end && (pos & 3); pos++) //up to the next byte
+			*out++ = "ACGT"[(words[pos >> 5] >> (62 - 2 * (pos & 31))) & 3];
+		for (; pos < end; pos += 4, out += 4)
+		{
+			unsigned int byte = (words[pos >> 5] >> (56 - 2 * (pos & 31))) & 0xFF;
+			memcpy(out, &quad[byte], 4);
+		}
+		buf.resize(start + n);
+	}
+
+	void add(const char* name, const unsigned long long* words, long long length)
+	{
+		if (curSize >= HDFS_BLOCK_SIZE)
+			nextHdl();
+		buf.push_back('>');
+		buf.insert(buf.end(), name, name + strlen(name));
+		buf.push_back('\n');
+		long long pos = 0;
+		do
+		{
+			long long line_end = (line_width > 0 && pos + line_width < length) ? pos + line_width : length;
+			while (pos < line_end)
+			{
+				int n = (line_end - pos < FASTA_CHUNK_BASES) ? line_end - pos : FASTA_CHUNK_BASES;
+				put_bases(words, pos, n);
+				pos += n;
+				if (buf.size() >= HDFS_BUF_SIZE)
+					flush_buf();
+			}
+			buf.push_back('\n');
+		} while (pos < length);
+	}
+};
+
+#endif
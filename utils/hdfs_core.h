@@ -7,6 +7,7 @@ const int HDFS_PORT=9000;
 
 #include "hdfs.h"
 #include "mpi.h"
+#include <zlib.h>
 
 #include <string.h>
 #include <stdlib.h>
@@ -125,6 +126,8 @@ hdfsFile getRWHandle(const char* path, hdfsFS fs)
 //buf[] is for batch reading from HDFS file
 //line[] is a line buffer, the string length is "length", the buffer size is "size"
 //after each readLine(), need to check eof(), if it's true, no line is read due to EOF
+//a gzip file (detected by its magic bytes) is inflated under the line buffer,
+//so the lines are those of the decompressed text
 struct LineReader
 {
 	//static fields
@@ -135,6 +138,12 @@ struct LineReader
 	hdfsFile handle;
 	bool fileEnd;
 
+	//gzip fields, zs is NULL for a plain file
+	z_stream* zs;
+	char* zbuf; //compressed input
+	bool zEnd; //no more compressed input
+	bool zMemberEnd; //the last gzip member was complete
+
 	//dynamic fields
 	char* line;
 	int length;
@@ -148,13 +157,95 @@ struct LineReader
 		this->fs = fs;
 		this->handle = handle;
 		fileEnd = false;
+		zs = NULL;
+		zbuf = NULL;
 		fill();
+		if (bufSize >= 2 && (unsigned char)buf[0] == 0x1f && (unsigned char)buf[1] == 0x8b)
+			initGzip();
 		line = (char*)malloc(LINE_DEFAULT_SIZE * sizeof(char));
 	}
 
 	~LineReader()
 	{
 		free(line);
+		if (zs != NULL)
+		{
+			inflateEnd(zs);
+			delete zs;
+			delete[] zbuf;
+		}
+	}
+
+	//internal use only! "buf" holds the first compressed bytes
+	void initGzip()
+	{
+		zbuf = new char[HDFS_BUF_SIZE];
+		memcpy(zbuf, buf, bufSize);
+		zs = new z_stream;
+		memset(zs, 0, sizeof(z_stream));
+		if (inflateInit2(zs, 15 + 16) != Z_OK) //15 + 16: zlib window, gzip header
+		{
+			fprintf(stderr, "Failed to initialize gzip decompression!\n");
+			exit(-1);
+		}
+		zs->next_in = (Bytef*)zbuf;
+		zs->avail_in = bufSize;
+		zEnd = fileEnd;
+		zMemberEnd = false;
+		fileEnd = false;
+		fill();
+	}
+
+	//internal use only!
+	void fillGzip()
+	{
+		zs->next_out = (Bytef*)buf;
+		zs->avail_out = HDFS_BUF_SIZE;
+		while (zs->avail_out > 0)
+		{
+			if (zs->avail_in == 0)
+			{
+				if (!zEnd)
+				{
+					tSize got = hdfsRead(fs, handle, zbuf, HDFS_BUF_SIZE);
+					if (got == -1)
+					{
+						fprintf(stderr, "Read Failure!\n");
+						exit(-1);
+					}
+					zs->next_in = (Bytef*)zbuf;
+					zs->avail_in = got;
+					if (got == 0)
+						zEnd = true;
+				}
+				if (zEnd && zs->avail_in == 0)
+				{
+					if (!zMemberEnd)
+					{
+						fprintf(stderr, "Truncated gzip file!\n");
+						exit(-1);
+					}
+					break;
+				}
+			}
+			int ret = inflate(zs, Z_NO_FLUSH);
+			if (ret == Z_STREAM_END)
+			{
+				inflateReset(zs); //the next gzip member, if any (e.g., bgzip output)
+				zMemberEnd = true;
+			}
+			else if (ret == Z_OK)
+				zMemberEnd = false;
+			else
+			{
+				fprintf(stderr, "Failed to decompress gzip file (zlib error %d)!\n", ret);
+				exit(-1);
+			}
+		}
+		bufSize = HDFS_BUF_SIZE - zs->avail_out;
+		bufPos = 0;
+		if (bufSize < HDFS_BUF_SIZE)
+			fileEnd = true;
 	}
 
 	//internal use only!
@@ -176,6 +267,11 @@ struct LineReader
 	//internal use only!
 	void fill()
 	{
+		if (zs != NULL)
+		{
+			fillGzip();
+			return;
+		}
 		bufSize = hdfsRead(fs, handle, buf, HDFS_BUF_SIZE);
 		if (bufSize == -1)
 		{
@@ -538,17 +634,19 @@ struct LineWriter
 	const char* path;
 	int me; //-1 if there's no concept of machines (like: hadoop fs -put)
 	int nxtPart;
-	int curSize;
+	size_t curSize; //bytes written to the current file, beyond 2 GiB if "split" is false
+	bool split; //false: everything goes to one file, even beyond HDFS_BLOCK_SIZE
 
 	hdfsFile curHdl;
 
-	LineWriter(const char* path, hdfsFS fs, int me)
+	LineWriter(const char* path, hdfsFS fs, int me, bool split = true)
 		: nxtPart(0)
 		, curSize(0)
 	{
 		this->path = path;
 		this->fs = fs;
 		this->me = me;
+		this->split = split;
 		curHdl = NULL;
 		//===============================
 		//if(overwrite==true) readDirForce();
@@ -644,7 +742,7 @@ struct LineWriter
 
 	void writeLine(char* line, int num)
 	{
-		if (curSize + num + 1 > HDFS_BLOCK_SIZE) //+1 because of '\n'
+		if (split && curSize + num + 1 > HDFS_BLOCK_SIZE) //+1 because of '\n'
 		{
 			nextHdl();
 		}
@@ -0,0 +1,306 @@
+#ifndef PACKED_READS_H
+#define PACKED_READS_H
+
+#include "hdfs_core.h"
+
+using namespace std;
+
+//====== Packed Read Format ======
+//written by "put -p", read by DeBruijn: a file is a PackedHeader followed by blocks, each block is:
+//   PackedBlockHeader
+//   unsigned int lengths[num_reads]
+//   unsigned int run_counts[num_reads]: number of 'N' runs of each read
+//   unsigned int runs[2 * num_runs]: (offset in the read, length) of each 'N' run, read by read
+//   unsigned long long words[num_words]: the bases of all reads back to back, 2 bits per base,
+//      A = 0, C = 1, G = 2, T = 3 (the k_mer code), the first base in the highest bits of a word
+//a non-ATGC base is stored as A and covered by a run, so a reader never decodes characters
+//the unsigned int arrays have an even number of entries, so the words are 8-byte aligned
+
+const unsigned int PACKED_MAGIC = 0x52415050; //"PPAR"
+const unsigned int PACKED_VERSION = 1;
+const unsigned int PACKED_BLOCK_BASES = 4194304; //4M bases, 1MB of words
+
+struct PackedHeader
+{
+	unsigned int magic;
+	unsigned int version;
+};
+
+struct PackedBlockHeader
+{
+	unsigned int num_reads;
+	unsigned int num_runs;
+	unsigned int num_words;
+	unsigned int reserved; //0
+};
+
+//a block in memory, "data" holds everything after the PackedBlockHeader
+struct PackedBlock
+{
+	PackedBlockHeader header;
+	vector<unsigned long long> data;
+	unsigned int* lengths;
+	unsigned int* run_counts;
+	unsigned int* runs;
+	unsigned long long* words;
+
+	//internal use only! number of 8-byte words after the header
+	static size_t data_words(const PackedBlockHeader & h)
+	{
+		return ((size_t)h.num_reads + h.num_runs) + h.num_words; //(2 * num_reads + 2 * num_runs) unsigned ints
+	}
+
+	void set_arrays()
+	{
+		lengths = (unsigned int*)&data[0];
+		run_counts = lengths + header.num_reads;
+		runs = run_counts + header.num_reads;
+		words = (unsigned long long*)(runs + 2 * header.num_runs);
+	}
+};
+
+//is "path" in the packed read format? (its first bytes are the magic number)
+bool is_packed_reads(hdfsFS fs, const char* path)
+{
+	hdfsFile in = getRHandle(path, fs);
+	PackedHeader header;
+	tSize got = hdfsRead(fs, in, &header, sizeof(PackedHeader));
+	hdfsCloseFile(fs, in);
+	return got == sizeof(PackedHeader) && header.magic == PACKED_MAGIC;
+}
+
+//appends the reads of "block" to "text", one per line, with 'N' for the bases covered by the runs
+//(for the tools that work on whole reads, the k+1 mer parsers read the words directly)
+void unpack_block(PackedBlock & block, string & text)
+{
+	static const char bases[4] = { 'A', 'C', 'G', 'T' };
+	unsigned long long pos = 0;
+	unsigned int* run = block.runs;
+	for (unsigned int r = 0; r < block.header.num_reads; r++)
+	{
+		size_t start = text.size();
+		for (unsigned int i = 0; i < block.lengths[r]; i++, pos++)
+			text.push_back(bases[(block.words[pos >> 5] >> (62 - 2 * (pos & 31))) & 3]);
+		for (unsigned int j = 0; j < block.run_counts[r]; j++, run += 2)
+			memset(&text[start + run[0]], 'N', run[1]);
+		text.push_back('\n');
+	}
+}
+
+//====== PackedReader ======
+//usage: while(reader.next(block)) { use block }
+struct PackedReader
+{
+	hdfsFS fs;
+	hdfsFile handle;
+	const char* path;
+
+	PackedReader(hdfsFS& fs, hdfsFile& handle, const char* path)
+	{
+		this->fs = fs;
+		this->handle = handle;
+		this->path = path;
+		PackedHeader header;
+		if (read_raw(&header, sizeof(PackedHeader)) != sizeof(PackedHeader) || header.magic != PACKED_MAGIC || header.version != PACKED_VERSION)
+		{
+			fprintf(stderr, "%s is not in the packed read format!\n", path);
+			exit(-1);
+		}
+	}
+
+	//internal use only! returns the number of bytes read, which is less than "size" only at EOF
+	size_t read_raw(void* bytes, size_t size)
+	{
+		size_t got = 0;
+		while (got < size)
+		{
+			tSize n = hdfsRead(fs, handle, (char*)bytes + got, size - got);
+			if (n == -1)
+			{
+				fprintf(stderr, "Read Failure!\n");
+				exit(-1);
+			}
+			if (n == 0)
+				break;
+			got += n;
+		}
+		return got;
+	}
+
+	bool next(PackedBlock & block)
+	{
+		size_t got = read_raw(&block.header, sizeof(PackedBlockHeader));
+		if (got == 0)
+			return false;
+		size_t bytes = PackedBlock::data_words(block.header) * sizeof(unsigned long long);
+		block.data.resize(bytes / sizeof(unsigned long long) + 1); //+1: never empty
+		if (got != sizeof(PackedBlockHeader) || read_raw(&block.data[0], bytes) != bytes)
+		{
+			fprintf(stderr, "Truncated block in %s!\n", path);
+			exit(-1);
+		}
+		block.set_arrays();
+		return true;
+	}
+};
+
+//====== PackedWriter ======
+//usage: add_read() for each read
+//like LineWriter, a new part file is started once the current one reaches HDFS_BLOCK_SIZE, unless "split" is false
+struct PackedWriter
+{
+	hdfsFS fs;
+	const char* path;
+	int me; //-1: files are named part_<n>, otherwise part_<me>_<n>
+	bool split;
+	int nxtPart;
+	hdfsFile curHdl;
+	size_t curSize;
+	//the current block
+	vector<unsigned int> lengths;
+	vector<unsigned int> run_counts;
+	vector<unsigned int> runs;
+	vector<unsigned long long> words;
+	unsigned long long num_bases;
+	unsigned char code[256]; //char -> 2-bit code, 4 for non-ATGC
+
+	PackedWriter(const char* path, hdfsFS fs, int me = -1, bool split = true)
+		: nxtPart(0)
+		, curSize(0)
+		, num_bases(0)
+	{
+		this->path = path;
+		this->fs = fs;
+		this->me = me;
+		this->split = split;
+		for (int i = 0; i < 256; i++)
+			code[i] = 4;
+		code['A'] = 0;
+		code['C'] = 1;
+		code['G'] = 2;
+		code['T'] = 3;
+		nextHdl();
+	}
+
+	~PackedWriter()
+	{
+		flush_block();
+		if (hdfsFlush(fs, curHdl))
+		{
+			fprintf(stderr, "Failed to 'flush' %s\n", path);
+			exit(-1);
+		}
+		hdfsCloseFile(fs, curHdl);
+	}
+
+	//internal use only!
+	void write_raw(const void* bytes, size_t size)
+	{
+		if (size == 0)
+			return;
+		tSize numWritten = hdfsWrite(fs, curHdl, bytes, size);
+		if (numWritten == -1)
+		{
+			fprintf(stderr, "Failed to write file!\n");
+			exit(-1);
+		}
+		curSize += size;
+	}
+
+	//internal use only!
+	void nextHdl()
+	{
+		char fname[30];
+		if (me >= 0)
+			sprintf(fname, "part_%d_%d", me, nxtPart);
+		else
+			sprintf(fname, "part_%d", nxtPart);
+		//flush old file
+		if (nxtPart > 0)
+		{
+			if (hdfsFlush(fs, curHdl))
+			{
+				fprintf(stderr, "Failed to 'flush' %s\n", path);
+				exit(-1);
+			}
+			hdfsCloseFile(fs, curHdl);
+		}
+		//open new file
+		nxtPart++;
+		char* filePath = new char[strlen(path) + strlen(fname) + 2];
+		sprintf(filePath, "%s/%s", path, fname);
+		curHdl = getWHandle(filePath, fs);
+		delete[] filePath;
+		curSize = 0;
+		PackedHeader header;
+		header.magic = PACKED_MAGIC;
+		header.version = PACKED_VERSION;
+		write_raw(&header, sizeof(PackedHeader));
+	}
+
+	//internal use only!
+	void flush_block()
+	{
+		if (lengths.empty())
+			return;
+		PackedBlockHeader header;
+		header.num_reads = lengths.size();
+		header.num_runs = runs.size() / 2;
+		header.num_words = words.size();
+		header.reserved = 0;
+		write_raw(&header, sizeof(PackedBlockHeader));
+		write_raw(&lengths[0], lengths.size() * sizeof(unsigned int));
+		write_raw(&run_counts[0], run_counts.size() * sizeof(unsigned int));
+		if (!runs.empty())
+			write_raw(&runs[0], runs.size() * sizeof(unsigned int));
+		if (!words.empty())
+			write_raw(&words[0], words.size() * sizeof(unsigned long long));
+		lengths.clear();
+		run_counts.clear();
+		runs.clear();
+		words.clear();
+		num_bases = 0;
+		if (split && curSize >= HDFS_BLOCK_SIZE)
+			nextHdl();
+	}
+
+	void add_read(const char* seq, int len)
+	{
+		unsigned int num_runs = 0;
+		int run_start = -1;
+		for (int i = 0; i < len; i++)
+		{
+			unsigned long long c = code[(unsigned char)seq[i]];
+			if (c == 4)
+			{
+				c = 0;
+				if (run_start < 0)
+					run_start = i;
+			}
+			else if (run_start >= 0)
+			{
+				runs.push_back(run_start);
+				runs.push_back(i - run_start);
+				num_runs++;
+				run_start = -1;
+			}
+			int slot = num_bases & 31;
+			if (slot == 0)
+				words.push_back(0);
+			words.back() |= c << (62 - 2 * slot);
+			num_bases++;
+		}
+		if (run_start >= 0)
+		{
+			runs.push_back(run_start);
+			runs.push_back(len - run_start);
+			num_runs++;
+		}
+		lengths.push_back(len);
+		run_counts.push_back(num_runs);
+		if (num_bases >= PACKED_BLOCK_BASES)
+			flush_block();
+	}
+};
+
+#endif
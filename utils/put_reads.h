@@ -0,0 +1,188 @@
+#ifndef PUT_READS_H
+#define PUT_READS_H
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include "hdfs_core.h"
+#include "seq_reader.h"
+#include "packed_reads.h"
+
+using namespace std;
+
+//====== Put: local read files -> HDFS, in parallel ======
+//each local file may be FASTQ, FASTA or one read per line, and gzip-compressed (see SeqReader),
+//a directory stands for the files in it
+//"num_threads" threads take the files one by one, cut their reads into chunks,
+//and append each chunk to the part that has got the fewest bases so far,
+//so the parts differ by at most one chunk whatever the sizes of the files are
+//(a chunk has at most PUT_CHUNK_SIZE bases, and about 1/64 of a part for small inputs)
+//num_parts = 0: a single stream of part files, a new one every HDFS_BLOCK_SIZE bytes (as putFASTQ)
+//num_parts > 0: exactly "num_parts" files part_<i>_0, e.g., the number of workers, so that dispatchRan balances them
+
+const size_t PUT_CHUNK_SIZE = 1048576; //1M
+
+struct PutParts
+{
+	hdfsFS fs;
+	bool packed;
+	int num_parts;
+	vector<LineWriter*> line_writers;
+	vector<PackedWriter*> packed_writers;
+	long long chunk_bases; //bases of a chunk
+	vector<long long> sizes; //bases given to each part
+	mutex pick_mtx; //guards "sizes"
+	vector<mutex> part_mtx; //guard the writers
+
+	PutParts(const char* hdfspath, bool packed, int num_parts, long long input_bytes)
+		: part_mtx(num_parts > 0 ? num_parts : 1)
+	{
+		fs = getHdfsFS();
+		this->packed = packed;
+		this->num_parts = (num_parts > 0) ? num_parts : 1;
+		chunk_bases = input_bytes / (64 * this->num_parts);
+		if (chunk_bases > PUT_CHUNK_SIZE)
+			chunk_bases = PUT_CHUNK_SIZE;
+		if (chunk_bases < LINE_DEFAULT_SIZE)
+			chunk_bases = LINE_DEFAULT_SIZE;
+		sizes.assign(this->num_parts, 0);
+		for (int i = 0; i < this->num_parts; i++)
+		{
+			int me = (num_parts > 0) ? i : -1;
+			bool split = (num_parts == 0);
+			if (packed)
+				packed_writers.push_back(new PackedWriter(hdfspath, fs, me, split));
+			else
+				line_writers.push_back(new LineWriter(hdfspath, fs, me, split));
+		}
+	}
+
+	~PutParts()
+	{
+		for (int i = 0; i < line_writers.size(); i++)
+			delete line_writers[i];
+		for (int i = 0; i < packed_writers.size(); i++)
+			delete packed_writers[i];
+		hdfsDisconnect(fs);
+	}
+
+	//"chunk" holds reads separated by '\n', "bases" is the number of bases in it
+	void write(string & chunk, long long bases)
+	{
+		if (chunk.empty())
+			return;
+		int part = 0;
+		{
+			lock_guard<mutex> lock(pick_mtx);
+			for (int i = 1; i < num_parts; i++)
+			{
+				if (sizes[i] < sizes[part])
+					part = i;
+			}
+			sizes[part] += bases;
+		}
+		lock_guard<mutex> lock(part_mtx[part]);
+		if (!packed)
+		{
+			line_writers[part]->writeLine(&chunk[0], chunk.size() - 1); //the chunk ends with '\n'
+			return;
+		}
+		PackedWriter* writer = packed_writers[part];
+		const char* p = chunk.c_str();
+		const char* end = p + chunk.size();
+		while (p < end)
+		{
+			const char* eol = (const char*)memchr(p, '\n', end - p);
+			writer->add_read(p, eol - p);
+			p = eol + 1;
+		}
+	}
+};
+
+//internal use only! a put thread
+void putFiles(PutParts* parts, vector<string>* files, atomic<size_t>* next_file)
+{
+	hdfsFS lfs = getlocalFS();
+	string chunk;
+	long long bases = 0;
+	size_t i;
+	while ((i = (*next_file)++) < files->size())
+	{
+		hdfsFile in = getRHandle((*files)[i].c_str(), lfs);
+		SeqReader* reader = new SeqReader(lfs, in);
+		while (reader->next())
+		{
+			chunk.append(reader->seq, reader->length);
+			chunk.push_back('\n');
+			bases += reader->length;
+			if (bases >= parts->chunk_bases)
+			{
+				parts->write(chunk, bases);
+				chunk.clear();
+				bases = 0;
+			}
+		}
+		delete reader;
+		hdfsCloseFile(lfs, in);
+	}
+	parts->write(chunk, bases);
+	hdfsDisconnect(lfs);
+}
+
+void putReads(const vector<string> & localpaths, const char* hdfspath, bool packed, int num_parts, int num_threads)
+{
+	if (dirCheck(hdfspath, false) == -1)
+		return;
+	//expand the directories
+	vector<string> files;
+	long long input_bytes = 0;
+	hdfsFS lfs = getlocalFS();
+	for (size_t i = 0; i < localpaths.size(); i++)
+	{
+		hdfsFileInfo* info = hdfsGetPathInfo(lfs, localpaths[i].c_str());
+		if (info == NULL)
+		{
+			fprintf(stderr, "Failed to get info of %s!\n", localpaths[i].c_str());
+			exit(-1);
+		}
+		bool is_dir = (info->mKind == kObjectKindDirectory);
+		if (!is_dir)
+			input_bytes += info->mSize;
+		hdfsFreeFileInfo(info, 1);
+		if (!is_dir)
+		{
+			files.push_back(localpaths[i]);
+			continue;
+		}
+		int numFiles;
+		hdfsFileInfo* fileinfo = hdfsListDirectory(lfs, localpaths[i].c_str(), &numFiles);
+		if (fileinfo == NULL)
+		{
+			fprintf(stderr, "Failed to list directory %s!\n", localpaths[i].c_str());
+			exit(-1);
+		}
+		for (int j = 0; j < numFiles; j++)
+		{
+			if (fileinfo[j].mKind == kObjectKindFile)
+			{
+				files.push_back(fileinfo[j].mName);
+				input_bytes += fileinfo[j].mSize;
+			}
+		}
+		hdfsFreeFileInfo(fileinfo, numFiles);
+	}
+	hdfsDisconnect(lfs);
+	//------
+	PutParts* parts = new PutParts(hdfspath, packed, num_parts, input_bytes);
+	atomic<size_t> next_file(0);
+	if (num_threads < 1)
+		num_threads = 1;
+	vector<thread> threads;
+	for (int t = 0; t < num_threads; t++)
+		threads.push_back(thread(putFiles, parts, &files, &next_file));
+	for (int t = 0; t < num_threads; t++)
+		threads[t].join();
+	delete parts;
+}
+
+#endif
@@ -0,0 +1,371 @@
+#ifndef RECORD_IO_H
+#define RECORD_IO_H
+
+#include <map>
+#include "hdfs_core.h"
+#include "communication.h"
+#include "serialization.h"
+
+using namespace std;
+
+//====== Binary Stage Format ======
+//a file is a RecordHeader followed by blocks, each block is:
+//   unsigned int payload_bytes, unsigned int num_records, payload
+//the payload holds "num_records" records serialized by ibinstream,
+//so the blocks are length-prefixed and the records need no delimiter
+
+bool binary_stage_io = true; //false: intermediate stages are written and read as text lines (for debugging)
+int record_k = 0; //k written to the headers, and checked when reading if it is not 0
+
+const unsigned int RECORD_MAGIC = 0x42415050; //"PPAB"
+const unsigned int RECORD_VERSION = 1;
+const int RECORD_BLOCK_SIZE = 1048576; //1M
+
+struct RecordHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	int k;
+	int type; //record type, defined by the stages
+};
+
+//====== In-Memory Pipeline ======
+//a path registered by keep_stage_in_memory() is not round-tripped through HDFS:
+//RecordWriter appends the records of this rank to mem_stages[path] (one header, then the blocks),
+//and the next stage loads them on the same rank instead of dispatching the HDFS splits
+//(the stage then re-partitions them by its own hash, as it does after loading splits)
+
+bool stage_hdfs_copy = true; //false: in-memory stages are not written to HDFS at all
+map<string, string> mem_stages;
+
+void keep_stage_in_memory(const string& path)
+{
+	mem_stages[path].clear();
+}
+
+void release_stage(const string& path) //call after the last stage that reads "path"
+{
+	mem_stages.erase(path);
+}
+
+inline bool stage_in_memory(const string& path)
+{
+	return mem_stages.find(path) != mem_stages.end();
+}
+
+//splits of "inpaths" assigned to this rank by the master, the in-memory stages are left out
+void assign_splits(const vector<string>& inpaths, bool native_dispatcher, vector<string>& assignedSplits)
+{
+	vector<string> hdfs_paths;
+	for (int i = 0; i < inpaths.size(); i++)
+	{
+		if (!stage_in_memory(inpaths[i]))
+			hdfs_paths.push_back(inpaths[i]);
+	}
+	if (hdfs_paths.empty())
+		return; //every rank registers the same paths
+	if (_my_rank == MASTER_RANK)
+	{
+		vector<vector<string> >* arrangement;
+		arrangement = native_dispatcher ? dispatchLocality(hdfs_paths) : dispatchRan(hdfs_paths);
+		masterScatter(*arrangement);
+		assignedSplits.swap((*arrangement)[0]);
+		delete arrangement;
+	}
+	else
+		slaveScatter(assignedSplits);
+}
+
+//====== RecordWriter ======
+//usage: check(); serialize one record into "m"; end_record();
+//like BufferedWriter, a new part file is started once the current one reaches HDFS_BLOCK_SIZE
+struct RecordWriter
+{
+	hdfsFS fs;
+	const char* path;
+	int me;
+	int nxtPart;
+	hdfsFile curHdl; //NULL if no HDFS file is written
+	size_t curSize; //bytes written to the current file
+	RecordHeader header;
+	ibinstream m; //the current block
+	unsigned int num; //number of records in the current block
+	string* mem; //in-memory copy, NULL if "path" is not an in-memory stage
+
+	RecordWriter(const char* path, hdfsFS fs, int me, int type)
+		: nxtPart(0)
+		, curSize(0)
+		, num(0)
+	{
+		this->path = path;
+		this->fs = fs;
+		this->me = me;
+		header.magic = RECORD_MAGIC;
+		header.version = RECORD_VERSION;
+		header.k = record_k;
+		header.type = type;
+		curHdl = NULL;
+		mem = NULL;
+		map<string, string>::iterator it = mem_stages.find(path);
+		if (it != mem_stages.end())
+		{
+			mem = &(it->second);
+			mem->assign((const char*)&header, sizeof(RecordHeader));
+		}
+		if (mem == NULL || stage_hdfs_copy)
+			nextHdl();
+	}
+
+	~RecordWriter()
+	{
+		flush_block();
+		if (curHdl == NULL)
+			return;
+		if (hdfsFlush(fs, curHdl))
+		{
+			fprintf(stderr, "Failed to 'flush' %s\n", path);
+			exit(-1);
+		}
+		hdfsCloseFile(fs, curHdl);
+	}
+
+	//internal use only!
+	void write_raw(const void* bytes, size_t size)
+	{
+		if (size == 0)
+			return;
+		tSize numWritten = hdfsWrite(fs, curHdl, bytes, size);
+		if (numWritten == -1)
+		{
+			fprintf(stderr, "Failed to write file!\n");
+			exit(-1);
+		}
+		curSize += size;
+	}
+
+	//internal use only!
+	void nextHdl()
+	{
+		char fname[20];
+		sprintf(fname, "part_%d_%d", me, nxtPart);
+		//flush old file
+		if (nxtPart > 0)
+		{
+			if (hdfsFlush(fs, curHdl))
+			{
+				fprintf(stderr, "Failed to 'flush' %s\n", path);
+				exit(-1);
+			}
+			hdfsCloseFile(fs, curHdl);
+		}
+		//open new file
+		nxtPart++;
+		char* filePath = new char[strlen(path) + strlen(fname) + 2];
+		sprintf(filePath, "%s/%s", path, fname);
+		curHdl = getWHandle(filePath, fs);
+		delete[] filePath;
+		curSize = 0;
+		write_raw(&header, sizeof(RecordHeader));
+	}
+
+	//internal use only!
+	void flush_block()
+	{
+		if (num == 0)
+			return;
+		unsigned int frame[2];
+		frame[0] = m.size();
+		frame[1] = num;
+		if (mem != NULL)
+		{
+			mem->append((const char*)frame, sizeof(frame));
+			mem->append(m.get_buf(), m.size());
+		}
+		if (curHdl != NULL)
+		{
+			write_raw(frame, sizeof(frame));
+			write_raw(m.get_buf(), m.size());
+		}
+		m.clear();
+		num = 0;
+	}
+
+	void check()
+	{
+		if (m.size() >= RECORD_BLOCK_SIZE)
+		{
+			flush_block();
+			if (curHdl != NULL && curSize >= HDFS_BLOCK_SIZE)
+				nextHdl();
+		}
+	}
+
+	inline void end_record()
+	{
+		num++;
+	}
+};
+
+//====== RecordReader ======
+//usage: while(reader.next()) { deserialize one record from reader.in(); }
+struct RecordReader
+{
+	hdfsFS fs;
+	hdfsFile handle;
+	const char* path;
+	const string* mem; //records of an in-memory stage, NULL when reading an HDFS file
+	size_t mem_pos;
+	RecordHeader header;
+	obinstream* um; //the current block
+	unsigned int left; //number of records left in the current block
+	bool empty; //the file has no header (e.g., written by a worker that had nothing to dump)
+
+	RecordReader(hdfsFS& fs, hdfsFile& handle, const char* path)
+		: mem(NULL)
+		, mem_pos(0)
+		, um(NULL)
+		, left(0)
+	{
+		this->fs = fs;
+		this->handle = handle;
+		this->path = path;
+		read_header(path);
+	}
+
+	//reads the records this rank kept for the in-memory stage "path"
+	RecordReader(const string& path)
+		: path(path.c_str())
+		, mem(&mem_stages[path])
+		, mem_pos(0)
+		, um(NULL)
+		, left(0)
+	{
+		read_header(this->path);
+	}
+
+	//internal use only!
+	void read_header(const char* path)
+	{
+		size_t got = read_raw(&header, sizeof(RecordHeader));
+		empty = (got == 0);
+		if (empty)
+			return;
+		if (got != sizeof(RecordHeader) || header.magic != RECORD_MAGIC || header.version != RECORD_VERSION)
+		{
+			fprintf(stderr, "%s is not in the binary stage format!\n", path);
+			exit(-1);
+		}
+		if (record_k != 0 && header.k != record_k)
+		{
+			fprintf(stderr, "%s was written with k = %d, but k = %d!\n", path, header.k, record_k);
+			exit(-1);
+		}
+	}
+
+	~RecordReader()
+	{
+		if (um != NULL)
+			delete um;
+	}
+
+	//internal use only! returns the number of bytes read, which is less than "size" only at EOF
+	size_t read_raw(void* bytes, size_t size)
+	{
+		if (mem != NULL)
+		{
+			size_t got = mem->size() - mem_pos;
+			if (got > size)
+				got = size;
+			memcpy(bytes, mem->data() + mem_pos, got);
+			mem_pos += got;
+			return got;
+		}
+		size_t got = 0;
+		while (got < size)
+		{
+			tSize n = hdfsRead(fs, handle, (char*)bytes + got, size - got);
+			if (n == -1)
+			{
+				fprintf(stderr, "Read Failure!\n");
+				exit(-1);
+			}
+			if (n == 0)
+				break;
+			got += n;
+		}
+		return got;
+	}
+
+	//internal use only!
+	bool next_block()
+	{
+		unsigned int frame[2];
+		size_t got = read_raw(frame, sizeof(frame));
+		if (got == 0)
+			return false;
+		if (got != sizeof(frame))
+		{
+			fprintf(stderr, "Truncated block in the binary stage format!\n");
+			exit(-1);
+		}
+		char* block = new char[frame[0]];
+		if (read_raw(block, frame[0]) != frame[0])
+		{
+			fprintf(stderr, "Truncated block in the binary stage format!\n");
+			exit(-1);
+		}
+		if (um != NULL)
+			delete um;
+		um = new obinstream(block, frame[0]); //um deletes the block
+		left = frame[1];
+		return true;
+	}
+
+	//moves to the next record, returns false at the end of the file
+	bool next()
+	{
+		if (empty)
+			return false;
+		while (left == 0)
+		{
+			if (!next_block())
+				return false;
+		}
+		left--;
+		return true;
+	}
+
+	inline obinstream& in()
+	{
+		return *um;
+	}
+
+	inline int type()
+	{
+		return header.type;
+	}
+};
+
+//====== Stage Inputs ======
+//loads the splits of "inpaths" dispatched by the master with (loader->*load_file)(path),
+//and this rank's part of the in-memory stages among them with (loader->*load_reader)(reader)
+template <class T>
+void load_stage_inputs(T* loader, void (T::*load_file)(const char*), void (T::*load_reader)(RecordReader&),
+		const vector<string>& inpaths, bool native_dispatcher)
+{
+	vector<string> assignedSplits;
+	assign_splits(inpaths, native_dispatcher, assignedSplits);
+	//reading assigned splits (map)
+	for (size_t i = 0; i < assignedSplits.size(); i++)
+		(loader->*load_file)(assignedSplits[i].c_str());
+	for (size_t i = 0; i < inpaths.size(); i++)
+	{
+		if (stage_in_memory(inpaths[i]))
+		{
+			RecordReader reader(inpaths[i]);
+			(loader->*load_reader)(reader);
+		}
+	}
+}
+
+#endif
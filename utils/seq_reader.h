@@ -0,0 +1,119 @@
+#ifndef SEQ_READER_H
+#define SEQ_READER_H
+
+#include "hdfs_core.h"
+
+using namespace std;
+
+//====== SeqReader ======
+//yields the sequences of a read file, whose layout is detected from its first line:
+//  FASTQ: 4-line records, the header starts with '@'
+//  FASTA: records whose header starts with '>', the sequence may span several lines
+//  otherwise: one sequence per line (the output of "put")
+//gzip files are inflated by LineReader, so .fastq.gz and .fa.gz need no staging copy
+//usage: while(reader.next()) { use reader.seq, with reader.length chars, '\0'-terminated }
+
+const int SEQ_RAW = 0;
+const int SEQ_FASTQ = 1;
+const int SEQ_FASTA = 2;
+
+struct SeqReader
+{
+	LineReader reader;
+	int format;
+	bool pending; //reader.line holds a line that is not consumed yet
+	int skip; //lines of the last FASTQ record still to skip ("+" and quality)
+
+	char* seq;
+	int length;
+	char* fasta_buf; //a FASTA sequence joined from its lines
+	int fasta_size;
+
+	SeqReader(hdfsFS& fs, hdfsFile& handle)
+		: reader(fs, handle)
+		, skip(0)
+		, seq(NULL)
+		, length(0)
+		, fasta_buf(NULL)
+		, fasta_size(0)
+	{
+		format = SEQ_RAW;
+		pending = read_nonempty();
+		if (pending)
+		{
+			if (reader.line[0] == '@')
+				format = SEQ_FASTQ;
+			else if (reader.line[0] == '>')
+				format = SEQ_FASTA;
+		}
+	}
+
+	~SeqReader()
+	{
+		if (fasta_buf != NULL)
+			free(fasta_buf);
+	}
+
+	//internal use only! returns false at EOF
+	bool read_nonempty()
+	{
+		while (true)
+		{
+			reader.readLine();
+			if (reader.eof())
+				return false;
+			if (reader.length > 0)
+				return true;
+		}
+	}
+
+	//internal use only!
+	void fasta_append(const char* first, int num)
+	{
+		while (length + num + 1 > fasta_size)
+		{
+			fasta_size = (fasta_size == 0) ? LINE_DEFAULT_SIZE : fasta_size * 2;
+			fasta_buf = (char*)realloc(fasta_buf, fasta_size);
+		}
+		memcpy(fasta_buf + length, first, num);
+		length += num;
+	}
+
+	bool next()
+	{
+		if (format == SEQ_FASTQ)
+		{
+			for (; skip > 0; skip--)
+				reader.readLine();
+			if (!pending && !read_nonempty())
+				return false;
+			pending = false; //the header
+			reader.readLine();
+			skip = 2;
+			seq = reader.getLine();
+			length = reader.length;
+			return true;
+		}
+		if (format == SEQ_FASTA)
+		{
+			if (!pending)
+				return false; //no header left
+			length = 0;
+			while ((pending = read_nonempty()) && reader.line[0] != '>')
+				fasta_append(reader.line, reader.length);
+			fasta_append("", 0);
+			fasta_buf[length] = '\0';
+			seq = fasta_buf;
+			return true;
+		}
+		//one sequence per line
+		if (!pending && !read_nonempty())
+			return false;
+		pending = false;
+		seq = reader.getLine();
+		length = reader.length;
+		return true;
+	}
+};
+
+#endif